@@ -0,0 +1,114 @@
+// heap traffic of parsing: malloc/calloc/realloc calls per line while a fixed
+// set of typical lines is replayed through parse_line and free_command_line
+// (the line's arena) and, for comparison, through per-command parse_input
+// and free_command (one heap block per piece)
+#include "bench.h"
+#include "parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// count every allocation made by the process, the parser's included
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void __libc_free(void *p);
+
+static unsigned long allocations = 0;
+
+void *malloc(size_t size)
+{
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+    allocations++;
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    allocations++;
+    return __libc_realloc(p, size);
+}
+
+void free(void *p)
+{
+    __libc_free(p);
+}
+
+static const char *workload[] = {
+    "ls -la",
+    "make -j8 > build.log",
+    "grep -rn TODO src include | sort | uniq -c | sort -rn | head -20",
+    "cat access.log | awk '{print $1}' | sort | uniq -c > hits.txt",
+    "hop ..",
+    "reveal -la /tmp",
+    "echo build done ; log",
+    "sleep 10 &",
+    "gcc -std=c99 -Wall -Wextra -O2 -c src/parser.c -o src/parser.o && echo ok",
+    "sort < input.txt > sorted.txt >> all.txt",
+    "tar czf backup.tgz docs src include Makefile README.md",
+    "find . -name *.c | xargs wc -l | tail -1",
+};
+#define LINES (sizeof(workload) / sizeof(workload[0]))
+
+static void replay_lines(int rounds)
+{
+    char buf[256];
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < LINES; i++)
+        {
+            strcpy(buf, workload[i]);
+            command_line_t *line = parse_line(buf);
+            if (!line)
+                exit(1);
+            free_command_line(line);
+        }
+    }
+}
+
+// the simple commands of every line, one parse_input each
+static void replay_commands(int rounds)
+{
+    char buf[256];
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < LINES; i++)
+        {
+            strcpy(buf, workload[i]);
+            char *save;
+            for (char *part = strtok_r(buf, "|;", &save); part; part = strtok_r(NULL, "|;", &save))
+                free_command(parse_input(part));
+        }
+    }
+}
+
+static void measure(const char *name, void (*replay)(int))
+{
+    const int rounds = 20000;
+    char metric[64];
+
+    // warm up once, so pooled memory is in place as it would be in a session
+    replay(1);
+    unsigned long before = allocations;
+    double start = bench_now();
+    replay(rounds);
+    double elapsed = bench_now() - start;
+    unsigned long count = allocations - before;
+
+    snprintf(metric, sizeof(metric), "%s_allocs_per_line", name);
+    bench_report("alloc", metric, (double)count / (rounds * LINES), "allocs/line");
+    snprintf(metric, sizeof(metric), "%s_parse_time", name);
+    bench_report("alloc", metric, elapsed * 1e9 / (rounds * LINES), "ns/line");
+}
+
+int main(void)
+{
+    measure("parse_line", replay_lines);
+    measure("parse_input", replay_commands);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// long generated command lines: parse and launch "true f0 f1 ... fN" with
+// N = 1k and 10k arguments (nothing is cut off at 64 words or 1 KiB anymore)
+#include "bench.h"
+#include "parser.h"
+#include "exec.h"
+#include <stdio.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *make_line(int args)
+{
+    size_t cap = 8 + (size_t)args * 16;
+    char *line = malloc(cap);
+    if (!line)
+        exit(1);
+    size_t len = sprintf(line, "true");
+    for (int i = 0; i < args; i++)
+        len += sprintf(line + len, " file%05d.txt", i);
+    return line;
+}
+
+int main(void)
+{
+    int counts[] = {1000, 10000};
+    // execute_command hands the terminal over to each child and takes it back
+    signal(SIGTTOU, SIG_IGN);
+
+    for (size_t n = 0; n < sizeof(counts) / sizeof(counts[0]); n++)
+    {
+        int args = counts[n];
+        char *line = make_line(args);
+        char metric[64];
+
+        // parse: the whole line into a tree
+        int rounds = 200;
+        double start = bench_now();
+        for (int r = 0; r < rounds; r++)
+            free_command_line(parse_line(line));
+        double parse = (bench_now() - start) / rounds;
+
+        command_line_t *parsed = parse_line(line);
+        if (!parsed || parsed->pipelines[0].commands[0]->argc != args + 1)
+        {
+            fprintf(stderr, "args: line was cut off\n");
+            return 1;
+        }
+        snprintf(metric, sizeof(metric), "%d_args_parse", args);
+        bench_report("args", metric, parse * 1e6, "us/line");
+        snprintf(metric, sizeof(metric), "%d_args_parse_rate", args);
+        bench_report("args", metric, strlen(line) / parse / (1024 * 1024), "MB/s");
+
+        // launch: spawn and wait, as a foreground command
+        rounds = 50;
+        start = bench_now();
+        for (int r = 0; r < rounds; r++)
+            execute_command(parsed->pipelines[0].commands[0]);
+        double launch = (bench_now() - start) / rounds;
+        snprintf(metric, sizeof(metric), "%d_args_launch", args);
+        bench_report("args", metric, launch * 1e3, "ms/command");
+
+        free_command_line(parsed);
+        free(line);
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// tiny helpers shared by the benchmark programs in bench/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// one result per line: <bench> <metric> <value> <unit>. With $BENCH_JSON set
+// (make bench does), the result is also appended there as a JSON object, one
+// per line; names are plain identifiers, so nothing needs escaping
+static inline void bench_report(const char *bench, const char *metric, double value, const char *unit)
+{
+    printf("%-16s %-36s %14.3f %s\n", bench, metric, value, unit);
+    fflush(stdout);
+
+    const char *json_path = getenv("BENCH_JSON");
+    FILE *json = json_path ? fopen(json_path, "a") : NULL;
+    if (!json)
+        return;
+    fprintf(json, "{\"bench\": \"%s\", \"metric\": \"%s\", ", bench, metric);
+    if (isfinite(value))
+        fprintf(json, "\"value\": %.6g, ", value);
+    else
+        fprintf(json, "\"value\": null, ");
+    fprintf(json, "\"unit\": \"%s\"}\n", unit);
+    fclose(json);
+}
+
+#endif
@@ -0,0 +1,32 @@
+// cost of deciding whether a command is a builtin: names from the table and
+// typical external commands, which now pay one hash and at most one strcmp
+#include "bench.h"
+#include "builtins.h"
+#include <stdio.h>
+
+#define ROUNDS 200000
+
+static const char *builtins[] = {"hop", "reveal", "log", "echo", "cat", "jobs", "fg", "activities"};
+static const char *externals[] = {"ls", "grep", "make", "gcc", "git", "sort", "sleep", "find"};
+#define NAMES 8
+
+static double lookups(const char **names)
+{
+    int found = 0;
+    double start = bench_now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < NAMES; i++)
+            found += builtin_find(names[i]) != NULL;
+    double elapsed = bench_now() - start;
+    // keep the loop from being optimized away
+    if (found < 0)
+        printf("%d\n", found);
+    return elapsed / ((double)ROUNDS * NAMES);
+}
+
+int main(void)
+{
+    bench_report("builtin", "lookup_builtin", lookups(builtins) * 1e9, "ns/lookup");
+    bench_report("builtin", "lookup_external", lookups(externals) * 1e9, "ns/lookup");
+    return 0;
+}
@@ -0,0 +1,44 @@
+// latency of execute_command, the whole foreground path: redirections,
+// spawn, wait4, the timing record. Compare with spawn_bench for the spawn alone
+#include "bench.h"
+#include "parser.h"
+#include "exec.h"
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+
+#define RUNS 500
+
+static void measure(const char *metric, const char *line)
+{
+    char buf[256];
+    strcpy(buf, line);
+    command_t *cmd = parse_input(buf);
+    if (!cmd)
+    {
+        fprintf(stderr, "exec: cannot parse \"%s\"\n", line);
+        return;
+    }
+
+    double start = bench_now();
+    for (int i = 0; i < RUNS; i++)
+        execute_command(cmd);
+    double elapsed = bench_now() - start;
+    if (last_exit_status != 0)
+        fprintf(stderr, "exec: \"%s\" exited with %d\n", line, last_exit_status);
+    bench_report("exec", metric, elapsed * 1e6 / RUNS, "us/command");
+    free_command(cmd);
+}
+
+int main(void)
+{
+    // execute_command hands the terminal to each child and takes it back,
+    // which stops a process that doesn't ignore SIGTTOU, as the shell does
+    signal(SIGTTOU, SIG_IGN);
+
+    measure("true", "true");
+    measure("absolute_path", "/bin/true");
+    measure("redirect_out", "true > /dev/null");
+    measure("redirect_in_out", "true < /dev/null > /dev/null");
+    return 0;
+}
@@ -0,0 +1,77 @@
+// job-table operations with 1k and 100k jobs: adding, finding by pid and by
+// job number, listing (activities), and removing. The pids are made up; no
+// signal is ever sent to them
+#include "bench.h"
+#include "jobs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define FIRST_PID 4000000
+#define LOOKUPS 1000
+#define REMOVALS 1000
+
+int main(void)
+{
+    int sizes[] = {1000, 100000};
+    char command[64];
+    char metric[64];
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int jobs = sizes[s];
+
+        double start = bench_now();
+        for (int i = 0; i < jobs; i++)
+        {
+            snprintf(command, sizeof(command), "sleep %d", jobs - i);
+            jobs_add(FIRST_PID + i, command);
+        }
+        snprintf(metric, sizeof(metric), "%d_jobs_add", jobs);
+        bench_report("jobs", metric, (bench_now() - start) * 1e9 / jobs, "ns/op");
+
+        // lookups spread over the whole table
+        int found = 0;
+        start = bench_now();
+        for (int i = 0; i < LOOKUPS; i++)
+            found += jobs_find_by_pid(FIRST_PID + (int)((long)i * jobs / LOOKUPS)) != NULL;
+        snprintf(metric, sizeof(metric), "%d_jobs_find_by_pid", jobs);
+        bench_report("jobs", metric, (bench_now() - start) * 1e9 / LOOKUPS, "ns/op");
+
+        start = bench_now();
+        for (int i = 0; i < LOOKUPS; i++)
+            found += jobs_find_by_id(job_list[0].job_id + (int)((long)i * jobs / LOOKUPS)) != NULL;
+        snprintf(metric, sizeof(metric), "%d_jobs_find_by_id", jobs);
+        bench_report("jobs", metric, (bench_now() - start) * 1e9 / LOOKUPS, "ns/op");
+        if (found != 2 * LOOKUPS)
+        {
+            fprintf(stderr, "jobs: %d of %d lookups found their job\n", found, 2 * LOOKUPS);
+            return 1;
+        }
+
+        // activities sorts the table and prints a line per job
+        fflush(stdout);
+        int saved_stdout = dup(STDOUT_FILENO);
+        if (!freopen("/dev/null", "w", stdout))
+            return 1;
+        start = bench_now();
+        jobs_print_activities();
+        fflush(stdout);
+        double listing = bench_now() - start;
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+        snprintf(metric, sizeof(metric), "%d_jobs_activities", jobs);
+        bench_report("jobs", metric, listing * 1e3, "ms/listing");
+
+        // a finished job leaves from the front of the table
+        start = bench_now();
+        for (int i = 0; i < REMOVALS && job_count > 0; i++)
+            jobs_remove_by_index(0);
+        snprintf(metric, sizeof(metric), "%d_jobs_remove_first", jobs);
+        bench_report("jobs", metric, (bench_now() - start) * 1e9 / REMOVALS, "ns/op");
+
+        while (job_count > 0)
+            jobs_remove_by_index(job_count - 1);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+// cost of one add_to_log call: the history file is read, updated and
+// written back every time, so this is mostly file I/O. Measured filling an
+// empty history and then with a full one, where every call shifts it
+#include "bench.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CALLS 2000
+
+static double add_calls(const char *home, int first, int count)
+{
+    char cmd[64];
+    double start = bench_now();
+    for (int i = first; i < first + count; i++)
+    {
+        // every command differs from the last, so none is dropped as a repeat
+        snprintf(cmd, sizeof(cmd), "make -j8 target%d > build.log", i);
+        add_to_log(cmd, home);
+    }
+    return (bench_now() - start) / count;
+}
+
+int main(void)
+{
+    char home[] = "/tmp/log_bench.XXXXXX";
+    if (!mkdtemp(home))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    bench_report("log", "add_to_log_filling", add_calls(home, 0, MAX_HISTORY) * 1e6, "us/call");
+    bench_report("log", "add_to_log_full", add_calls(home, MAX_HISTORY, CALLS) * 1e6, "us/call");
+
+    char path[128];
+    snprintf(path, sizeof(path), "%s/.shell_history", home);
+    unlink(path);
+    rmdir(home);
+    return 0;
+}
@@ -0,0 +1,64 @@
+// what the parse cache saves: a set of typical lines replayed through plain
+// parse_line and through parse_cached, once with every line fitting in the
+// cache (a loop body, "log execute") and once cycling through more distinct
+// lines than it holds, where every lookup misses
+#include "bench.h"
+#include "parser.h"
+#include "parsecache.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *workload[] = {
+    "ls -la",
+    "make -j8 > build.log",
+    "grep -rn TODO src include | sort | uniq -c | sort -rn | head -20",
+    "cat access.log | awk '{print $1}' | sort | uniq -c > hits.txt",
+    "hop ..",
+    "reveal -la /tmp",
+    "echo build done ; log",
+    "sleep 10 &",
+    "gcc -std=c99 -Wall -Wextra -O2 -c src/parser.c -o src/parser.o && echo ok",
+    "sort < input.txt > sorted.txt >> all.txt",
+    "tar czf backup.tgz docs src include Makefile README.md",
+    "find . -name *.c | xargs wc -l | tail -1",
+};
+#define LINES (sizeof(workload) / sizeof(workload[0]))
+#define DISTINCT 256
+#define ROUNDS 20000
+
+static char lines[DISTINCT][128];
+
+static double replay(int distinct, bool cached)
+{
+    double start = bench_now();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int i = 0; i < distinct; i++)
+        {
+            command_line_t *line = cached ? parse_cached(lines[i]) : parse_line(lines[i]);
+            if (!line)
+            {
+                fprintf(stderr, "parsecache: \"%s\" did not parse\n", lines[i]);
+                return 0;
+            }
+            if (cached)
+                parse_cache_release(line);
+            else
+                free_command_line(line);
+        }
+    }
+    return (bench_now() - start) / ((double)ROUNDS * distinct);
+}
+
+int main(void)
+{
+    // DISTINCT variants of the workload, told apart by a trailing argument
+    for (int i = 0; i < DISTINCT; i++)
+        snprintf(lines[i], sizeof(lines[i]), "%s x%d", workload[i % LINES], i / (int)LINES);
+
+    bench_report("parsecache", "parse_line", replay(LINES, false) * 1e9, "ns/line");
+    bench_report("parsecache", "cached_hits", replay(LINES, true) * 1e9, "ns/line");
+    parse_cache_clear();
+    bench_report("parsecache", "cached_misses", replay(DISTINCT, true) * 1e9, "ns/line");
+    return 0;
+}
@@ -0,0 +1,54 @@
+// throughput of execute_pipeline: 64 MiB pushed through 2-, 4- and 8-stage
+// cat chains with the default pipe size and with larger F_SETPIPE_SZ buffers
+#include "bench.h"
+#include "pipe.h"
+#include "parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BYTES (64u << 20)
+
+static double pipeline_mb_per_s(int stages, size_t buffer)
+{
+    command_t *commands[stages + 1];
+    char line[128];
+
+    snprintf(line, sizeof(line), "head -c %u /dev/zero", BYTES);
+    commands[0] = parse_input(line);
+    for (int i = 1; i < stages; i++)
+    {
+        strcpy(line, i == stages - 1 ? "cat > /dev/null" : "cat");
+        commands[i] = parse_input(line);
+    }
+    commands[stages] = NULL;
+
+    pipe_buffer_size = buffer;
+    double start = bench_now();
+    execute_pipeline(commands, false);
+    double elapsed = bench_now() - start;
+
+    for (int i = 0; i < stages; i++)
+        free_command(commands[i]);
+    return BYTES / (1024.0 * 1024.0) / elapsed;
+}
+
+int main(void)
+{
+    size_t sizes[] = {0, 256u << 10, pipe_max_size()};
+    int stage_counts[] = {2, 4, 8};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (size_t n = 0; n < sizeof(stage_counts) / sizeof(stage_counts[0]); n++)
+        {
+            char metric[64];
+            if (sizes[s])
+                snprintf(metric, sizeof(metric), "%d_stages_%zuK_pipes", stage_counts[n], sizes[s] >> 10);
+            else
+                snprintf(metric, sizeof(metric), "%d_stages_default_pipes", stage_counts[n]);
+            bench_report("pipe", metric, pipeline_mb_per_s(stage_counts[n], sizes[s]), "MB/s");
+        }
+    }
+    return 0;
+}
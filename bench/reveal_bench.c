@@ -0,0 +1,86 @@
+// reveal over synthetic directories of 1k, 10k and 100k empty files (1M too
+// with BENCH_LARGE=1; creating it takes far longer than listing it), plain
+// and with -l. The listing goes to /dev/null
+#include "bench.h"
+#include "reveal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+static void fill(const char *dir, int entries)
+{
+    char path[256];
+    for (int i = 0; i < entries; i++)
+    {
+        snprintf(path, sizeof(path), "%s/entry%07d", dir, i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0)
+        {
+            perror(path);
+            exit(1);
+        }
+        close(fd);
+    }
+}
+
+static void empty(const char *dir, int entries)
+{
+    char path[256];
+    for (int i = 0; i < entries; i++)
+    {
+        snprintf(path, sizeof(path), "%s/entry%07d", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+static double reveal_time(char *dir, char *flags, int rounds, FILE *out)
+{
+    char *args[] = {"reveal", flags, dir, NULL};
+    if (!flags)
+    {
+        args[1] = dir;
+        args[2] = NULL;
+    }
+    double start = bench_now();
+    for (int r = 0; r < rounds; r++)
+        execute_reveal(args, "/tmp", out);
+    return (bench_now() - start) / rounds;
+}
+
+int main(void)
+{
+    int sizes[] = {1000, 10000, 100000, 1000000};
+    int count = getenv("BENCH_LARGE") ? 4 : 3;
+    FILE *out = fopen("/dev/null", "w");
+    if (!out)
+    {
+        perror("/dev/null");
+        return 1;
+    }
+
+    for (int s = 0; s < count; s++)
+    {
+        char dir[] = "/tmp/reveal_bench.XXXXXX";
+        if (!mkdtemp(dir))
+        {
+            perror("mkdtemp");
+            return 1;
+        }
+        fill(dir, sizes[s]);
+
+        // about the same total work at every size
+        int rounds = sizes[s] >= 100000 ? 3 : 100000 / sizes[s];
+        char metric[64];
+        snprintf(metric, sizeof(metric), "%d_entries", sizes[s]);
+        bench_report("reveal", metric, reveal_time(dir, NULL, rounds, out) * 1e3, "ms/listing");
+        snprintf(metric, sizeof(metric), "%d_entries_lines", sizes[s]);
+        bench_report("reveal", metric, reveal_time(dir, "-l", rounds, out) * 1e3, "ms/listing");
+
+        empty(dir, sizes[s]);
+    }
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// tokenizer throughput with each word scanner: the raw scan over every word
+// of a line, then whole lines through parse_line, for typical short lines and
+// for long generated ones (a build script's compile lines, a huge argument list)
+#include "bench.h"
+#include "parser.h"
+#include "scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *impls[] = {"scalar", "sse2", "avx2"};
+
+static const char *typical[] = {
+    "ls -la",
+    "make -j8 > build.log",
+    "grep -rn TODO src include | sort | uniq -c | sort -rn | head -20",
+    "cat access.log | awk '{print $1}' | sort | uniq -c > hits.txt",
+    "hop ..",
+    "reveal -la /tmp",
+    "echo build done ; log",
+    "sleep 10 &",
+    "gcc -std=c99 -Wall -Wextra -O2 -c src/parser.c -o src/parser.o && echo ok",
+    "sort < input.txt > sorted.txt >> all.txt",
+    "tar czf backup.tgz docs src include Makefile README.md",
+    "find . -name *.c | xargs wc -l | tail -1",
+};
+#define TYPICAL (sizeof(typical) / sizeof(typical[0]))
+
+// one compile line of a generated build script
+static char *compile_line(void)
+{
+    char *line = malloc(16384);
+    size_t len = sprintf(line, "/usr/bin/x86_64-linux-gnu-gcc-12");
+    for (int i = 0; i < 40; i++)
+        len += sprintf(line + len, " -I/home/builder/project/third_party/library%02d/include", i);
+    sprintf(line + len, " -c /home/builder/project/src/module/implementation.c"
+                        " -o /home/builder/project/build/module/implementation.o > build.log");
+    return line;
+}
+
+// 10k short file names
+static char *args_line(void)
+{
+    char *line = malloc(200000);
+    size_t len = sprintf(line, "rm -f");
+    for (int i = 0; i < 10000; i++)
+        len += sprintf(line + len, " file%05d.txt", i);
+    return line;
+}
+
+// every word of the line, scanned in turn; the same walk tokenize does
+static size_t scan_all(const char *line, size_t (*scan)(const char *))
+{
+    size_t words = 0;
+    for (const char *p = line; *p;)
+    {
+        size_t n = scan(p);
+        if (n == 0)
+            n = 1;
+        else
+            words++;
+        p += n;
+    }
+    return words;
+}
+
+static void measure(const char *workload, const char **lines, int count, int rounds)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < count; i++)
+        bytes += strlen(lines[i]);
+
+    for (size_t k = 0; k < sizeof(impls) / sizeof(impls[0]); k++)
+    {
+        if (!scan_word_select(impls[k]))
+            continue;
+        char metric[64];
+
+        // the scanners must agree with the scalar one on where words end
+        size_t words = 0, expected = 0;
+        double start = bench_now();
+        for (int r = 0; r < rounds; r++)
+            for (int i = 0; i < count; i++)
+                words += scan_all(lines[i], scan_word);
+        double scan = bench_now() - start;
+        for (int i = 0; i < count; i++)
+            expected += scan_all(lines[i], scan_word_scalar);
+        if (words != expected * rounds)
+        {
+            fprintf(stderr, "scan: %s disagrees with scalar on %s\n", impls[k], workload);
+            exit(1);
+        }
+        snprintf(metric, sizeof(metric), "%s_%s_scan", workload, impls[k]);
+        bench_report("scan", metric, bytes * rounds / scan / (1024 * 1024), "MB/s");
+
+        start = bench_now();
+        for (int r = 0; r < rounds; r++)
+            for (int i = 0; i < count; i++)
+                free_command_line(parse_line(lines[i]));
+        double parse = bench_now() - start;
+        snprintf(metric, sizeof(metric), "%s_%s_parse", workload, impls[k]);
+        bench_report("scan", metric, (double)count * rounds / parse, "lines/s");
+        snprintf(metric, sizeof(metric), "%s_%s_parse_rate", workload, impls[k]);
+        bench_report("scan", metric, bytes * rounds / parse / (1024 * 1024), "MB/s");
+    }
+}
+
+int main(void)
+{
+    char *compile = compile_line();
+    char *args = args_line();
+    const char *compile_lines[] = {compile};
+    const char *args_lines[] = {args};
+
+    measure("typical", typical, TYPICAL, 20000);
+    measure("compile", compile_lines, 1, 20000);
+    measure("10k_args", args_lines, 1, 100);
+
+    free(compile);
+    free(args);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// per-spawn latency of the spawn layer: posix_spawn vs the fork fallback,
+// with and without a large touched heap (a long-lived shell's address space)
+#include "bench.h"
+#include "spawner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#define SPAWNS 500
+
+static double spawn_latency_us(spawn_mode_t mode)
+{
+    char *argv[] = {"true", NULL};
+    spawn_request_t req;
+    spawn_request_init(&req, argv);
+    spawn_mode = mode;
+
+    double start = bench_now();
+    for (int i = 0; i < SPAWNS; i++)
+    {
+        pid_t pid = spawn_process(&req);
+        if (pid < 0)
+        {
+            perror("spawn_process");
+            exit(1);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return (bench_now() - start) * 1e6 / SPAWNS;
+}
+
+int main(void)
+{
+    bench_report("spawn", "posix_spawn_small_heap", spawn_latency_us(SPAWN_AUTO), "us/spawn");
+    bench_report("spawn", "fork_small_heap", spawn_latency_us(SPAWN_FORK), "us/spawn");
+
+    // 256 MiB of dirty pages for fork to copy page tables for
+    size_t ballast_size = 256u << 20;
+    char *ballast = malloc(ballast_size);
+    if (!ballast)
+        return 1;
+    memset(ballast, 1, ballast_size);
+
+    bench_report("spawn", "posix_spawn_256M_heap", spawn_latency_us(SPAWN_AUTO), "us/spawn");
+    bench_report("spawn", "fork_256M_heap", spawn_latency_us(SPAWN_FORK), "us/spawn");
+
+    free(ballast);
+    return 0;
+}
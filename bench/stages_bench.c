@@ -0,0 +1,49 @@
+// pipeline setup cost against stage count: "true | cat | ... | cat" with
+// 2 to 256 stages, timed from execute_pipeline's call to its last reap
+#include "bench.h"
+#include "pipe.h"
+#include "parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static double pipeline_ms(int stages, int rounds)
+{
+    command_t **commands = calloc(stages + 1, sizeof(command_t *));
+    if (!commands)
+        exit(1);
+    for (int i = 0; i < stages; i++)
+    {
+        char word[8];
+        strcpy(word, i == 0 ? "true" : "cat");
+        commands[i] = parse_input(word);
+    }
+
+    double start = bench_now();
+    for (int r = 0; r < rounds; r++)
+        execute_pipeline(commands, false);
+    double elapsed = (bench_now() - start) / rounds;
+
+    for (int i = 0; i < stages; i++)
+        free_command(commands[i]);
+    free(commands);
+    return elapsed * 1e3;
+}
+
+int main(void)
+{
+    int stage_counts[] = {2, 8, 32, 128, 256};
+
+    for (size_t n = 0; n < sizeof(stage_counts) / sizeof(stage_counts[0]); n++)
+    {
+        int stages = stage_counts[n];
+        int rounds = stages >= 128 ? 5 : 50;
+        double ms = pipeline_ms(stages, rounds);
+        char metric[64];
+        snprintf(metric, sizeof(metric), "%d_stages", stages);
+        bench_report("stages", metric, ms, "ms/pipeline");
+        snprintf(metric, sizeof(metric), "%d_stages_per_stage", stages);
+        bench_report("stages", metric, ms * 1e3 / stages, "us/stage");
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+// throughput of the two other ways into the parser: is_valid_syntax, which
+// only checks the grammar, and parse_input, one heap-allocated command
+#include "bench.h"
+#include "parser.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *workload[] = {
+    "ls -la",
+    "make -j8 > build.log",
+    "grep -rn TODO src include | sort | uniq -c | sort -rn | head -20",
+    "cat access.log | awk '{print $1}' | sort | uniq -c > hits.txt",
+    "hop ..",
+    "reveal -la /tmp",
+    "echo build done ; log",
+    "sleep 10 &",
+    "gcc -std=c99 -Wall -Wextra -O2 -c src/parser.c -o src/parser.o && echo ok",
+    "sort < input.txt > sorted.txt >> all.txt",
+    "tar czf backup.tgz docs src include Makefile README.md",
+    "find . -name *.c | xargs wc -l | tail -1",
+};
+#define LINES (sizeof(workload) / sizeof(workload[0]))
+#define ROUNDS 20000
+
+static void report(const char *name, double elapsed, size_t bytes)
+{
+    char metric[64];
+    snprintf(metric, sizeof(metric), "%s_rate", name);
+    bench_report("syntax", name, (double)LINES * ROUNDS / elapsed, "lines/s");
+    bench_report("syntax", metric, bytes * ROUNDS / elapsed / (1024 * 1024), "MB/s");
+}
+
+int main(void)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < LINES; i++)
+        bytes += strlen(workload[i]);
+
+    char buf[256];
+    int valid = 0;
+    double start = bench_now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (size_t i = 0; i < LINES; i++)
+        {
+            strcpy(buf, workload[i]);
+            valid += is_valid_syntax(buf);
+        }
+    if (valid != (int)LINES * ROUNDS)
+    {
+        fprintf(stderr, "syntax: a workload line was rejected\n");
+        return 1;
+    }
+    report("is_valid_syntax", bench_now() - start, bytes);
+
+    // parse_input may cut a trailing newline off, so it gets a copy
+    start = bench_now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (size_t i = 0; i < LINES; i++)
+        {
+            strcpy(buf, workload[i]);
+            free_command(parse_input(buf));
+        }
+    report("parse_input", bench_now() - start, bytes);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// bump allocator: many small allocations, all released at once by a reset.
+// Memory comes in chunks; a reset keeps the newest chunk for the next round
+typedef struct arena_chunk arena_chunk_t;
+
+typedef struct arena {
+    arena_chunk_t *head;
+} arena_t;
+
+void arena_init(arena_t *arena);
+// suitably aligned for any type; NULL when out of memory
+void *arena_alloc(arena_t *arena, size_t size);
+char *arena_strndup(arena_t *arena, const char *s, size_t n);
+void arena_reset(arena_t *arena);
+void arena_destroy(arena_t *arena);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "exec.h"
+
+// every builtin writes to out (stdout, already redirected, in the foreground)
+// and reports failure through last_exit_status
+typedef void (*builtin_fn)(char **args, FILE *out);
+// the worker-thread flavour: leaves the shell's globals alone and returns the exit status
+typedef int (*builtin_task_fn)(char **args, FILE *out);
+
+// a prefix keyword: runs the rest of the pipeline (line), through run, its own way
+typedef void (*builtin_prefix_fn)(char *line, void (*run)(char *));
+
+typedef enum {
+    BUILTIN_COMMAND,    // a command like any other, just without a fork
+    BUILTIN_SHELL,      // works on the shell itself (jobs, exit): always runs in the
+                        // shell, in the foreground; "&" is ignored and a pipeline
+                        // stage of that name is an external command
+    BUILTIN_PREFIX,     // "time", "launch", ...: only a keyword at the start of a
+                        // pipeline; anywhere else the name is an external command
+} builtin_kind_t;
+
+// one entry of the builtin table
+typedef struct builtin {
+    const char *name;
+    builtin_kind_t kind;
+    builtin_fn run;                 // BUILTIN_COMMAND and BUILTIN_SHELL
+    builtin_prefix_fn prefix;       // BUILTIN_PREFIX
+    bool in_process;    // "&" and pipeline stages may run it on a worker thread
+                        // instead of forking a child for it
+    builtin_task_fn run_in_thread;  // what that thread runs, when run would touch
+                                    // shell state (Ctrl-C, last_exit_status); else run
+} builtin_t;
+
+// an in-process background job (see run_builtin_background)
+typedef struct bg_task bg_task_t;
+
+// log execute needs a way back into the command driver
+void builtins_set_runner(void (*run_command)(char *));
+
+// NULL for anything that isn't a builtin: one hash and at most one strcmp
+const builtin_t *builtin_find(const char *name);
+// startup self-check: every table entry is found under its own name
+bool builtin_table_ok(void);
+// the builtin to run cmd with, or NULL when it goes to an external program
+// (cat -n, cat on the terminal, a prefix keyword past the start of a pipeline).
+// piped_in: stdin comes from the previous stage
+const builtin_t *builtin_for(const command_t *cmd, bool piped_in);
+// in_process, less the argument lists that need a child after all
+bool builtin_runs_in_thread(const builtin_t *builtin, char **args);
+
+void builtin_echo(char **args, FILE *out);
+
+// foreground: install the redirections around the call
+void run_builtin_foreground(builtin_fn fn, char **args, redir_t *redir);
+// background: a worker thread when possible, otherwise a forked child; either way a job
+void run_builtin_background(const builtin_t *builtin, char **args, redir_t *redir, char *job_cmd);
+
+// run the builtin on a worker thread that writes to its own dup of out_fd
+// (-1: stdout). NULL if no thread could be started
+bg_task_t *builtin_start_writer(const builtin_t *builtin, char **args, int out_fd);
+
+bool bg_task_done(bg_task_t *task);
+// joins the worker and releases everything it owned; the builtin's exit status
+int bg_task_finish(bg_task_t *task);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef CAT_H
+#define CAT_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// cat [file...]: copies each file ("-" or none = stdin) to out without a
+// userspace buffer where the kernel allows it (splice, copy_file_range,
+// sendfile)
+void execute_cat(char **args, FILE *out);
+
+// true when the command should run as the external cat instead: any option,
+// or reading stdin while that is the terminal
+bool cat_wants_external(char **args, bool stdin_is_tty);
+
+// the same copy on a worker thread ("cat file &", a pipeline's writer stage):
+// Ctrl-C is left to the foreground, and the status is returned, not set
+int cat_in_thread(char **args, FILE *out);
+
+// false when cat needs the shell's stdin (no files, or "-"), the external cat,
+// or reads something other than regular files, which might never end
+bool cat_runs_in_thread(char **args);
+
+#endif
@@ -1,8 +0,0 @@
-#ifndef CONFIG_H
-#define CONFIG_H
-
-#define INPUT_SIZE 1024
-#define MAX_ARGS   64
-#define MAX_CMDS   10
-
-#endif
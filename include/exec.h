@@ -4,7 +4,34 @@
 
 #include <stdbool.h>
 
-int validate_redirections(command_t *cmd);
+#define REDIR_INPUT  1
+#define REDIR_OUTPUT 2
+
+struct fanout;
+
+// close-on-exec descriptors opened once during validation; -1 when not redirected.
+// With several ">" targets out_fd is a pipe and fanout the relay behind it
+typedef struct redir {
+    int in_fd;
+    int out_fd;
+    struct fanout *fanout;
+} redir_t;
+
+// batch mode sets this while running its final line
+extern bool exec_in_place;
+// whether a whole command line is simple enough to run that way
+bool can_exec_in_place(const char *line);
+// exit code of the last foreground command/pipeline (127 = not found)
+extern int last_exit_status;
+
+int exit_code_from_status(int status);
+
+int open_redirections(command_t *cmd, int which, redir_t *redir);
+int validate_redirections(command_t *cmd, redir_t *redir);
+// close our copies; a fan-out relay finishes by itself once the command's are closed too
+void close_redirections(redir_t *redir);
+// same, for a command that has finished: returns once the fan-out output is all written
+void wait_redirections(redir_t *redir);
 void execute_command(command_t *cmd);
 
 #endif
\ No newline at end of file
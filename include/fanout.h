@@ -0,0 +1,22 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stdbool.h>
+
+// "cmd > a > b >> c": the command writes into one pipe and a relay thread
+// copies every byte to each target, tee(2)'d in the kernel
+typedef struct fanout fanout_t;
+
+// takes over fds[0..count) (append[i]: opened O_APPEND) and hands back the
+// pipe's write end in *write_fd. NULL with nothing taken over on failure
+fanout_t *fanout_start(const int *fds, const bool *append, int count, int *write_fd);
+
+// the relay ends once every copy of the write end is closed. wait blocks
+// until then, release lets it finish on its own; both give up the handle
+void fanout_wait(fanout_t *fanout);
+void fanout_release(fanout_t *fanout);
+
+// relays still copying (they die with the shell)
+int fanout_active(void);
+
+#endif
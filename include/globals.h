@@ -9,5 +9,6 @@
 #endif
 
 extern char prev_dir[PATH_MAX];
+extern char home_dir[1024];
 
 #endif
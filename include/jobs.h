@@ -2,22 +2,51 @@
 #define JOBS_H
 
 #include <sys/types.h>
+#include <stdbool.h>
 
-typedef enum { RUNNING, STOPPED } job_state_t;
+typedef enum { RUNNING, STOPPED, QUEUED } job_state_t;
+
+struct bg_task;
 
 typedef struct {
     int job_id;
-    pid_t pid;
+    pid_t pid;              // process group id; 0 while QUEUED: nothing has been started yet
     job_state_t state;
-    char command[1024];
+    char *command;
+    struct bg_task *task;   // in-process builtin job, NULL for child processes
+    pid_t *members;         // processes of the job still alive; a pipeline has one per stage
+    int member_count;
+    pid_t last_member;      // the final stage, whose status is the job's
+    int last_status;
+    char **heredocs;        // QUEUED: here-document bodies the line needs when it starts
+    int heredoc_count;
 } job_t;
 
-extern job_t job_list[1024];
+extern job_t *job_list;
 extern int job_count;
 
 // Job management
 void jobs_add(pid_t pid, char *command);
-void reap_background_children(void);
+// a whole pipeline as one job: pids all belong to process group pgid
+void jobs_add_group(pid_t pgid, const pid_t *pids, int count, const char *command, job_state_t state);
+// one member of a job ended; true once none are left
+bool jobs_member_done(job_t *job, pid_t pid, int status);
+void jobs_add_task(struct bg_task *task, char *command);
+bool jobs_reap_tasks(void);
+void jobs_kill_all(void);
+void jobs_forget_all(void);
+
+// admission control: with a limit set, "&" lines past it wait in the table as
+// QUEUED and are started by jobs_admit_queued() as running jobs finish
+void jobs_set_launcher(void (*run_command)(char *));
+void jobs_set_limit(int limit);
+void jobs_print_limit(void);
+bool jobs_should_queue(void);
+// heredocs: the bodies the line took when it was parsed, copied for later
+void jobs_queue(const char *line, char *const *heredocs, int heredoc_count);
+int jobs_queued(void);
+int jobs_tasks_running(void);
+bool jobs_admit_queued(void);
 void jobs_mark_stopped(pid_t pid);
 void jobs_ping(pid_t pid, int sig_num);
 void jobs_print_activities(void);
@@ -0,0 +1,41 @@
+#ifndef LAUNCH_H
+#define LAUNCH_H
+
+#include <stdbool.h>
+#include <sys/resource.h>
+
+#define LAUNCH_MAX_CPUS 1024
+// one per name launch.c knows (limit_names), so every limit given fits
+#define LAUNCH_MAX_LIMITS 9
+
+// placement and priority applied to a child between fork and exec.
+// only the fields whose has_* flag (or limit_count) is set are applied
+typedef struct launch_attrs {
+    bool has_cpus;
+    unsigned char cpus[LAUNCH_MAX_CPUS / 8];   // affinity bitmap
+    bool has_nice;
+    int nice;
+    bool has_ioprio;
+    int io_class;                             // 1 = realtime, 2 = best-effort, 3 = idle
+    int io_level;                             // 0 (highest) .. 7
+    int limit_count;
+    struct {
+        int resource;
+        rlim_t value;
+    } limits[LAUNCH_MAX_LIMITS];
+} launch_attrs_t;
+
+// the attributes a new child should get: the session defaults, the background
+// defaults for "&" jobs, then whatever a "launch" prefix asked for.
+// NULL when there is nothing to apply
+const launch_attrs_t *launch_attrs_for(bool background);
+
+// called in the child; failures are reported on stderr and the exec goes ahead
+void launch_apply(const launch_attrs_t *attrs);
+
+// "launch [opts] cmd..." runs cmd with opts on top of the defaults;
+// "launch -s opts" / "launch -b opts" set the session / background defaults,
+// "launch" alone prints them. line is everything after the keyword
+void execute_launch(char *line, void (*run_command)(char *));
+
+#endif
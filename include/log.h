@@ -2,11 +2,15 @@
 #define LOG_H
 
 #include <stdbool.h>
+#include <stdio.h>
 
 #define MAX_HISTORY 15
 #define MAX_CMD_LEN 1024
 
 void add_to_log(char *cmd, const char *home_dir);
-void execute_log(char **args, const char *home_dir, void (*run_command)(char*));
+// false: add_to_log does nothing. For a forked copy of the shell, whose
+// commands are not the user's and would race the shell on the history file
+void log_set_enabled(bool enabled);
+void execute_log(char **args, const char *home_dir, void (*run_command)(char*), FILE *out);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdio.h>
+
+// parallel [-j N] cmd [args with {}] [::: inputs...]
+// runs cmd once per input (inputs from stdin lines when ::: is absent),
+// keeping at most N children alive; reports each task on out
+void execute_parallel(char **args, FILE *out);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include "parser.h"
+
+// parse_line with a memory: the trees of recently run lines are kept and
+// handed out again when the same line comes back. A cached tree is shared
+// and must not be changed; give it back with parse_cache_release
+command_line_t *parse_cached(const char *input);
+void parse_cache_release(command_line_t *line);
+
+void parse_cache_clear(void);
+
+#endif
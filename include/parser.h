@@ -9,19 +9,71 @@ typedef struct command {
     bool background;
 
     char **in_files;
+    bool *in_here;      // true if in_files[i] is the text of a "<<" or "<<<", not a path
     int in_count;
 
     char **out_files;
     bool *out_append;   // true if ">>"
     int out_count;
+
+    bool in_arena;      // part of a parsed line: freed with it, free_command does nothing
 } command_t;
 
+// one pipeline of a line, and how it is joined to the one before it
+typedef struct pipeline {
+    command_t **commands;   // NULL-terminated
+    int count;
+    bool background;        // followed by "&"
+    bool if_success;        // follows "&&": runs only if the previous pipeline succeeded
+    char *text;             // as typed, "&" included; for jobs, history and prefix keywords
+    char **heredocs;        // the here-document bodies it took off the queue, in order;
+    int heredoc_count;      // a queued job puts them back when it starts
+} pipeline_t;
+
+// a whole line: pipelines separated by ";", "&&" and "&"
+typedef struct command_line {
+    pipeline_t *pipelines;
+    int count;
+    struct arena *arena;    // holds the line's tokens and every part of the tree
+    bool has_heredoc;       // took bodies off the here-document queue: good for one run only
+} command_line_t;
 
-// Updated return type
+// tokenizes the line once and builds the tree; NULL on a syntax error
+command_line_t *parse_line(const char *input);
+// releases the whole tree in one step
+void free_command_line(command_line_t *line);
+
+// a single command, "&" setting background; heap allocated, free with free_command
 command_t *parse_input(char *input);
 
 void free_command(command_t *cmd);
+
+// here-documents: whoever reads the input collects the body of every
+// "<<word" on a line (heredoc_find says which) and queues it; parse_input
+// takes them back in the same order. Leftovers are dropped with heredoc_clear
+typedef struct heredoc_spec {
+    char *delim;
+    bool strip_tabs;    // "<<-": leading tabs come off every body line and the delimiter
+} heredoc_spec_t;
+
+int heredoc_find(const char *line, heredoc_spec_t **specs);
+void heredoc_free_specs(heredoc_spec_t *specs, int count);
+void heredoc_push(char *body);
+void heredoc_clear(void);
+
+// a line run from inside another (a queued job starting) brings bodies of its
+// own: heredoc_save sets the reader's queue aside and starts an empty one,
+// heredoc_restore drops whatever is left of that and brings the saved one back
+typedef struct heredoc_queue {
+    char **bodies;
+    int count;
+    int next;
+    int capacity;
+} heredoc_queue_t;
+
+void heredoc_save(heredoc_queue_t *saved);
+void heredoc_restore(const heredoc_queue_t *saved);
+
 bool is_valid_syntax(char *input);
-bool parse_input_redirection(void);
 
 #endif
@@ -0,0 +1,15 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+// resolve a command name to an executable path, remembering the answer.
+// names containing '/' are returned as-is; NULL means "not found in $PATH"
+const char *path_lookup(const char *name);
+
+// drop one entry (e.g. after its exec failed) or the whole table
+void path_cache_forget(const char *name);
+void path_cache_clear(void);
+
+// hash [-r] [-p path name] [name ...]
+void execute_hash(char **args);
+
+#endif
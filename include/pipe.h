@@ -2,8 +2,20 @@
 #define PIPE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "parser.h"
 
+// capacity given to every inter-stage pipe; 0 keeps the kernel default (64 KiB)
+extern size_t pipe_buffer_size;
+
+// /proc/sys/fs/pipe-max-size, the most an unprivileged process may ask for
+size_t pipe_max_size(void);
+
+// "pipebuf [size|max|default]" sets the session's pipe size, "pipebuf size
+// pipeline" sizes just that pipeline, "pipebuf" alone prints the setting.
+// line is everything after the keyword
+void execute_pipebuf(char *line, void (*run_command)(char *));
+
 void execute_pipeline(command_t **commands, bool background);void extract_redirection_and_cleanup(char **args, char **input_file, char **output_file, bool *append);
 
 #endif // PIPE_H
@@ -0,0 +1,28 @@
+#ifndef PIPESTAT_H
+#define PIPESTAT_H
+
+#include <stdbool.h>
+#include "parser.h"
+
+// set while a "pipestat" pipeline runs; execute_pipeline then puts a relay
+// on every link between stages
+extern bool pipestat_active;
+
+typedef struct pipestat_link pipestat_link_t;
+
+// take over in_fd (the read end of a stage's output pipe) and splice it into
+// a new pipe, whose read end comes back in *out_fd for the next stage.
+// NULL (with nothing changed) if the relay could not be set up
+pipestat_link_t *pipestat_link_start(int in_fd, int *out_fd);
+
+// links[i] sits between commands[i] and commands[i + 1] (NULL: no relay).
+// waits for every relay, prints the report on stderr and frees them
+void pipestat_finish(pipestat_link_t **links, command_t **commands, int count);
+
+// a stopped pipeline keeps its relays running without us
+void pipestat_abandon(pipestat_link_t **links, int count);
+
+// "pipestat pipeline"; line is everything after the keyword
+void execute_pipestat(char *line, void (*run_command)(char *));
+
+#endif
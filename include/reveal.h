@@ -2,7 +2,8 @@
 #define REVEAL_H
 
 #include <stdbool.h>
+#include <stdio.h>
 
-void execute_reveal(char** args, const char* home_dir);
+void execute_reveal(char** args, const char* home_dir, FILE *out);
 
 #endif
\ No newline at end of file
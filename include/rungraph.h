@@ -0,0 +1,12 @@
+#ifndef RUNGRAPH_H
+#define RUNGRAPH_H
+
+#include <stdio.h>
+
+// rungraph [-j N] file
+// file lines look like "target: dep1 dep2; command". Nodes whose deps all
+// succeeded run in parallel (at most N at once), each in a subshell through
+// run_command; a failure skips everything that depends on it
+void execute_rungraph(char **args, FILE *out, void (*run_command)(char *));
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// length of the word starting at p: the bytes before the first NUL,
+// whitespace or shell metacharacter (| & < > ;). Scans 16 or 32 bytes at a
+// time where the CPU allows, picked once at runtime
+size_t scan_word(const char *p);
+
+// the same, a byte at a time; what the vector versions must agree with
+size_t scan_word_scalar(const char *p);
+
+// which version scan_word uses: "avx2", "sse2" or "scalar"
+const char *scan_word_impl(void);
+// switch scan_word to one of those (for comparisons); false if not available here
+bool scan_word_select(const char *impl);
+
+#endif
@@ -2,8 +2,16 @@
 #ifndef SIGNALS_H
 #define SIGNALS_H
 
+#include <sys/types.h>
+
 // new bool declaration:
 bool process_signal_events(void);
+void wait_for_batch_jobs(void);
+bool handle_child_status(pid_t pid, int status);
+bool take_interrupt(void);
+
+struct rusage;
+pid_t wait_child_or_interrupt(int *status, struct rusage *ru);
 
 void install_signal_handlers(void);
 
@@ -0,0 +1,45 @@
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+struct launch_attrs;
+
+typedef enum { SPAWN_AUTO, SPAWN_FORK } spawn_mode_t;
+
+// everything a child needs before exec; -1 fds mean "inherit from the shell"
+typedef struct spawn_request {
+    char **argv;
+    pid_t pgid;       // 0 = new group led by the child, > 0 = join that group
+    int in_fd;        // installed on stdin
+    int out_fd;       // installed on stdout
+    bool null_stdin;  // background jobs read from /dev/null
+    const struct launch_attrs *attrs;  // affinity/priority/limits (see launch.h), or NULL
+} spawn_request_t;
+
+// SPAWN_AUTO uses posix_spawn (clone(CLONE_VM|CLONE_VFORK) in glibc),
+// SPAWN_FORK forces the plain fork+exec path. Requests carrying launch attrs
+// always fork, since posix_spawn cannot set them
+extern spawn_mode_t spawn_mode;
+
+void spawn_request_init(spawn_request_t *req, char **argv);
+
+// argv[0] is resolved through the PATH cache (see pathcache.h).
+// returns the child's pid, or -1 with errno set if the program could not be
+// started (exec failures are reported here, no child is left behind)
+pid_t spawn_process(const spawn_request_t *req);
+
+// like execvp, a file the kernel refuses with ENOEXEC (no "#!") is run by
+// /bin/sh as a script, both here and in spawn_exec_in_place
+
+// tell the user why a program could not be started: "Command not found!" and
+// 127 for a missing one, "name: reason" and 126 for anything else. Returns
+// the exit status to use
+int spawn_report_failure(const char *name, int err);
+
+// replace the shell itself with the program (pgid is left alone);
+// only returns, with errno set, if the exec failed
+void spawn_exec_in_place(const spawn_request_t *req);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <sys/resource.h>
+
+// set between timing_begin() and timing_end() while a "time" command runs
+extern bool timing_active;
+
+double timing_now(void);
+
+// an enclosing "time" report, put aside while a nested one runs
+// (e.g. "time log execute 1" where that entry is itself "time ...")
+typedef struct {
+    bool active;
+    struct stage_usage *stages;
+    int stage_count;
+    int stage_capacity;
+    double begin_wall;
+    struct rusage begin_self;
+} timing_frame_t;
+
+// saves any report already running into *outer
+void timing_begin(timing_frame_t *outer);
+// called by the foreground waiters for every reaped child
+void timing_record(const char *name, double wall, const struct rusage *ru);
+// prints the per-stage and total report to stderr, then picks *outer back up;
+// the outer report counts the stages of the nested one too
+void timing_end(timing_frame_t *outer);
+
+// "time pipeline"; line is everything after the keyword
+void execute_time(char *line, void (*run)(char *));
+
+#endif
@@ -0,0 +1,77 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+// enough for a typical line's tokens and tree in one chunk
+#define ARENA_CHUNK (8 * 1024)
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+    arena_chunk_t *next;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGN) unsigned char data[];
+};
+
+void arena_init(arena_t *arena)
+{
+    arena->head = NULL;
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arena_chunk_t *chunk = arena->head;
+    if (!chunk || chunk->size - chunk->used < size)
+    {
+        // grow geometrically so a long line needs only a few chunks
+        size_t chunk_size = chunk ? chunk->size * 2 : ARENA_CHUNK;
+        while (chunk_size < size)
+            chunk_size *= 2;
+        chunk = malloc(sizeof(arena_chunk_t) + chunk_size);
+        if (!chunk)
+            return NULL;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+    void *p = chunk->data + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+char *arena_strndup(arena_t *arena, const char *s, size_t n)
+{
+    char *copy = arena_alloc(arena, n + 1);
+    if (copy)
+    {
+        memcpy(copy, s, n);
+        copy[n] = '\0';
+    }
+    return copy;
+}
+
+void arena_reset(arena_t *arena)
+{
+    arena_chunk_t *chunk = arena->head;
+    if (!chunk)
+        return;
+    // the newest chunk is also the largest
+    arena_chunk_t *old = chunk->next;
+    while (old)
+    {
+        arena_chunk_t *next = old->next;
+        free(old);
+        old = next;
+    }
+    chunk->next = NULL;
+    chunk->used = 0;
+}
+
+void arena_destroy(arena_t *arena)
+{
+    arena_reset(arena);
+    free(arena->head);
+    arena->head = NULL;
+}
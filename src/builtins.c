@@ -0,0 +1,414 @@
+#include "builtins.h"
+#include "hop.h"
+#include "reveal.h"
+#include "log.h"
+#include "jobs.h"
+#include "globals.h"
+#include "parallel.h"
+#include "rungraph.h"
+#include "cat.h"
+#include "pathcache.h"
+#include "launch.h"
+#include "pipestat.h"
+#include "pipe.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+
+struct bg_task {
+    pthread_t thread;
+    const builtin_t *builtin;
+    char **argv;
+    FILE *out;
+    int status; // the builtin's exit status, valid once done
+    int done;   // set by the worker, read by the main loop
+};
+
+static void (*run_line)(char *) = NULL;
+
+void builtins_set_runner(void (*run_command)(char *))
+{
+    run_line = run_command;
+}
+
+// builtin echo helper
+void builtin_echo(char **args, FILE *out)
+{
+    for (int i = 1; args[i] != NULL; i++)
+    {
+        fprintf(out, "%s", args[i]);
+        if (args[i + 1] != NULL)
+            fprintf(out, " ");
+    }
+    fprintf(out, "\n");
+}
+
+// hop reports errors on stdout, which the foreground path has already redirected
+static void builtin_hop(char **args, FILE *out)
+{
+    execute_hop(args, home_dir);
+}
+
+static void builtin_reveal(char **args, FILE *out)
+{
+    execute_reveal(args, home_dir, out);
+}
+
+static void builtin_log(char **args, FILE *out)
+{
+    execute_log(args, home_dir, run_line, out);
+}
+
+static void builtin_rungraph(char **args, FILE *out)
+{
+    execute_rungraph(args, out, run_line);
+}
+
+static void builtin_hash(char **args, FILE *out)
+{
+    execute_hash(args);
+}
+
+static void builtin_logout(char **args, FILE *out)
+{
+    jobs_kill_all();
+    printf("logout\n");
+    exit(0);
+}
+
+static void builtin_activities(char **args, FILE *out)
+{
+    jobs_print_activities();
+}
+
+// jobs -j N: at most N background jobs run at once, the rest queue
+static void builtin_jobs(char **args, FILE *out)
+{
+    if (!args[1])
+    {
+        jobs_print_limit();
+    }
+    else if (strcmp(args[1], "-j") == 0 && args[2] && isdigit((unsigned char)args[2][0]))
+    {
+        jobs_set_limit(atoi(args[2]));
+    }
+    else
+    {
+        printf("Usage: jobs [-j <limit>]\n");
+        last_exit_status = 2;
+    }
+}
+
+static void builtin_ping(char **args, FILE *out)
+{
+    if (!args[1] || !args[2])
+    {
+        printf("Usage: ping <pid> <signal_number>\n");
+        return;
+    }
+    pid_t pid = (pid_t)atoi(args[1]);
+    int sig = atoi(args[2]) % 32;
+    jobs_ping(pid, sig);
+}
+
+static void builtin_fg(char **args, FILE *out)
+{
+    if (job_count == 0)
+    {
+        printf("No such job\n");
+        return;
+    }
+    int job_num;
+    if (args[1])
+    {
+        job_num = atoi(args[1]);
+    }
+    else
+    {
+        job_num = job_list[job_count - 1].job_id;
+    }
+    jobs_fg(job_num);
+}
+
+static void builtin_bg(char **args, FILE *out)
+{
+    if (!args[1])
+    {
+        printf("Usage: bg <job_number>\n");
+        return;
+    }
+    jobs_bg(atoi(args[1]));
+}
+
+// a perfect hash: the slot comes from a name's length and first and last
+// characters, with multipliers picked so that no two builtins share one.
+// The compiler places every entry, and two landing in the same slot fail the
+// build (-Woverride-init); a new builtin is one more line, or new multipliers.
+// The first and last characters have to be spelled out (a string literal's
+// characters are no constant expression); builtin_table_ok catches a typo
+#define BUILTIN_SLOTS 64
+#define BUILTIN_SLOT(len, first, last) \
+    (((len) + 3 * (unsigned char)(first) + 2 * (unsigned char)(last)) & (BUILTIN_SLOTS - 1))
+#define BUILTIN_ENTRY(name, first, last, kind, run, prefix, in_process, run_in_thread) \
+    [BUILTIN_SLOT(sizeof(name) - 1, first, last)] = {name, kind, run, prefix, in_process, run_in_thread}
+#define BUILTIN(name, first, last, run, in_process, run_in_thread) \
+    BUILTIN_ENTRY(name, first, last, BUILTIN_COMMAND, run, NULL, in_process, run_in_thread)
+#define SHELL_BUILTIN(name, first, last, run) \
+    BUILTIN_ENTRY(name, first, last, BUILTIN_SHELL, run, NULL, false, NULL)
+#define PREFIX_BUILTIN(name, first, last, prefix) \
+    BUILTIN_ENTRY(name, first, last, BUILTIN_PREFIX, NULL, prefix, false, NULL)
+
+static const builtin_t builtin_table[BUILTIN_SLOTS] = {
+    // hop would move the whole shell from a worker thread, not just the job
+    BUILTIN("hop", 'h', 'p', builtin_hop, false, NULL),
+    BUILTIN("reveal", 'r', 'l', builtin_reveal, true, NULL),
+    // log rewrites ~/.shell_history, which the main loop does after every command,
+    // and log execute runs a whole line through the driver
+    BUILTIN("log", 'l', 'g', builtin_log, false, NULL),
+    BUILTIN("echo", 'e', 'o', builtin_echo, true, NULL),
+    // parallel and rungraph reap with wait4(-1), which must not race the main loop
+    BUILTIN("parallel", 'p', 'l', execute_parallel, false, NULL),
+    BUILTIN("rungraph", 'r', 'h', builtin_rungraph, false, NULL),
+    BUILTIN("cat", 'c', 't', execute_cat, true, cat_in_thread),
+    SHELL_BUILTIN("hash", 'h', 'h', builtin_hash),
+    SHELL_BUILTIN("logout", 'l', 't', builtin_logout),
+    SHELL_BUILTIN("activities", 'a', 's', builtin_activities),
+    SHELL_BUILTIN("jobs", 'j', 's', builtin_jobs),
+    SHELL_BUILTIN("ping", 'p', 'g', builtin_ping),
+    SHELL_BUILTIN("fg", 'f', 'g', builtin_fg),
+    SHELL_BUILTIN("bg", 'b', 'g', builtin_bg),
+    PREFIX_BUILTIN("time", 't', 'e', execute_time),
+    PREFIX_BUILTIN("pipebuf", 'p', 'f', execute_pipebuf),     // inter-stage pipe capacity
+    PREFIX_BUILTIN("pipestat", 'p', 't', execute_pipestat),   // per-link throughput and stall report
+    PREFIX_BUILTIN("launch", 'l', 'h', execute_launch),       // placement and priority for what follows
+};
+
+const builtin_t *builtin_find(const char *name)
+{
+    size_t len = strlen(name);
+    if (len == 0)
+        return NULL;
+    const builtin_t *builtin = &builtin_table[BUILTIN_SLOT(len, name[0], name[len - 1])];
+    if (builtin->name && strcmp(builtin->name, name) == 0)
+        return builtin;
+    return NULL;
+}
+
+bool builtin_table_ok(void)
+{
+    bool ok = true;
+    for (int i = 0; i < BUILTIN_SLOTS; i++)
+    {
+        const char *name = builtin_table[i].name;
+        if (name && builtin_find(name) != &builtin_table[i])
+        {
+            fprintf(stderr, "builtin table: wrong first/last character for %s\n", name);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+const builtin_t *builtin_for(const command_t *cmd, bool piped_in)
+{
+    const builtin_t *builtin = builtin_find(cmd->argv[0]);
+    if (builtin && builtin->kind == BUILTIN_PREFIX)
+        return NULL;
+    if (builtin && builtin->run == execute_cat)
+    {
+        bool stdin_is_tty = !piped_in && cmd->in_count == 0 && isatty(STDIN_FILENO);
+        if (cat_wants_external(cmd->argv, stdin_is_tty))
+            return NULL;
+    }
+    return builtin;
+}
+
+bool builtin_runs_in_thread(const builtin_t *builtin, char **args)
+{
+    if (!builtin->in_process)
+        return false;
+    if (builtin->run == execute_cat)
+        return cat_runs_in_thread(args);
+    return true;
+}
+
+void run_builtin_foreground(builtin_fn fn, char **args, redir_t *redir)
+{
+    int saved_stdin = -1;
+    int saved_stdout = -1;
+
+    if (redir->in_fd >= 0)
+    {
+        saved_stdin = dup(STDIN_FILENO);
+        dup2(redir->in_fd, STDIN_FILENO);
+    }
+
+    if (redir->out_fd >= 0)
+    {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        dup2(redir->out_fd, STDOUT_FILENO);
+    }
+
+    fn(args, stdout);
+
+    if (saved_stdin >= 0)
+    {
+        dup2(saved_stdin, STDIN_FILENO);
+        close(saved_stdin);
+    }
+    if (saved_stdout >= 0)
+    {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+}
+
+static void fork_builtin(builtin_fn fn, char **args, redir_t *redir, char *job_cmd)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        setpgid(0, 0);
+        if (redir->in_fd >= 0)
+            dup2(redir->in_fd, STDIN_FILENO);
+        if (redir->out_fd >= 0)
+            dup2(redir->out_fd, STDOUT_FILENO);
+        fn(args, stdout);
+        fflush(stdout);
+        _exit(EXIT_SUCCESS);
+    }
+    else if (pid > 0)
+    {
+        setpgid(pid, pid);
+        jobs_add(pid, job_cmd);
+    }
+    else
+    {
+        perror("fork failed");
+    }
+}
+
+static char **copy_argv(char **args)
+{
+    int n = 0;
+    while (args[n])
+        n++;
+    char **copy = calloc(n + 1, sizeof(char *));
+    if (!copy)
+        return NULL;
+    for (int i = 0; i < n; i++)
+    {
+        copy[i] = strdup(args[i]);
+        if (!copy[i])
+        {
+            while (i-- > 0)
+                free(copy[i]);
+            free(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static void free_argv(char **argv)
+{
+    if (!argv)
+        return;
+    for (int i = 0; argv[i]; i++)
+        free(argv[i]);
+    free(argv);
+}
+
+static void *task_main(void *arg)
+{
+    bg_task_t *task = arg;
+    const builtin_t *builtin = task->builtin;
+    if (builtin->run_in_thread)
+        task->status = builtin->run_in_thread(task->argv, task->out);
+    else
+        builtin->run(task->argv, task->out);
+    // closing our end is what tells a pipe reader the output is complete
+    fclose(task->out);
+    task->out = NULL;
+    __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+bool bg_task_done(bg_task_t *task)
+{
+    return __atomic_load_n(&task->done, __ATOMIC_ACQUIRE) != 0;
+}
+
+int bg_task_finish(bg_task_t *task)
+{
+    pthread_join(task->thread, NULL);
+    int status = task->status;
+    free_argv(task->argv);
+    free(task);
+    return status;
+}
+
+// the worker writes through its own FILE on a private dup of the output fd,
+// so it never touches the shell's stdout buffer
+bg_task_t *builtin_start_writer(const builtin_t *builtin, char **args, int out_fd)
+{
+    bg_task_t *task = calloc(1, sizeof(bg_task_t));
+    if (!task)
+        return NULL;
+
+    int fd = fcntl(out_fd >= 0 ? out_fd : STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+    task->out = fd >= 0 ? fdopen(fd, "w") : NULL;
+    task->argv = copy_argv(args);
+    task->builtin = builtin;
+    if (!task->out || !task->argv)
+    {
+        if (task->out)
+            fclose(task->out);
+        else if (fd >= 0)
+            close(fd);
+        free_argv(task->argv);
+        free(task);
+        return NULL;
+    }
+
+    // signals belong to the main loop, never to a worker. That includes
+    // SIGPIPE: a reader that quits early just makes the worker's writes fail
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int err = pthread_create(&task->thread, NULL, task_main, task);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (err != 0)
+    {
+        fclose(task->out);
+        free_argv(task->argv);
+        free(task);
+        return NULL;
+    }
+    return task;
+}
+
+static bool start_task(const builtin_t *builtin, char **args, redir_t *redir, char *job_cmd)
+{
+    bg_task_t *task = builtin_start_writer(builtin, args, redir->out_fd);
+    if (!task)
+        return false;
+    jobs_add_task(task, job_cmd);
+    return true;
+}
+
+void run_builtin_background(const builtin_t *builtin, char **args, redir_t *redir, char *job_cmd)
+{
+    if (builtin_runs_in_thread(builtin, args) && start_task(builtin, args, redir, job_cmd))
+        return;
+    fork_builtin(builtin->run, args, redir, job_cmd);
+}
@@ -0,0 +1,208 @@
+// splice, copy_file_range and sendfile are Linux interfaces
+#define _GNU_SOURCE
+#include "cat.h"
+#include "exec.h"
+#include "signals.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+
+// bytes per kernel call; large enough that the syscall count doesn't matter
+#define CAT_CHUNK (1 << 20)
+
+typedef enum { COPY_SPLICE, COPY_FILE_RANGE, COPY_SENDFILE, COPY_READ_WRITE } copy_method_t;
+
+static bool has_options(char **args)
+{
+    for (int i = 1; args[i]; i++)
+        if (args[i][0] == '-' && args[i][1] != '\0')
+            return true;
+    return false;
+}
+
+static bool reads_stdin(char **args)
+{
+    if (!args[1])
+        return true;
+    for (int i = 1; args[i]; i++)
+        if (strcmp(args[i], "-") == 0)
+            return true;
+    return false;
+}
+
+bool cat_wants_external(char **args, bool stdin_is_tty)
+{
+    // options (-n, -A, ...) are the external cat's business, and there is
+    // nothing to gain from a terminal, which only a foreground job may read
+    return has_options(args) || (stdin_is_tty && reads_stdin(args));
+}
+
+bool cat_runs_in_thread(char **args)
+{
+    // a worker thread has no stdin of its own, and can't wait for a child
+    // without racing the main loop's reaper
+    if (reads_stdin(args) || has_options(args))
+        return false;
+    // nor can anything stop it: only regular files are sure to run out.
+    // /dev/zero, a fifo or a terminal gets a child that can be killed
+    for (int i = 1; args[i]; i++)
+    {
+        struct stat st;
+        if (stat(args[i], &st) == 0 && !S_ISREG(st.st_mode))
+            return false;
+    }
+    return true;
+}
+
+// the kernel picks the zero-copy path by what the two ends are
+static copy_method_t pick_method(int in_fd, int out_fd)
+{
+    struct stat in_st, out_st;
+    if (fstat(in_fd, &in_st) < 0 || fstat(out_fd, &out_st) < 0)
+        return COPY_READ_WRITE;
+
+    if (S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode))
+        return COPY_SPLICE;
+    // copy_file_range refuses O_APPEND targets ("cat a >> b")
+    if (S_ISREG(in_st.st_mode) && S_ISREG(out_st.st_mode) && !(fcntl(out_fd, F_GETFL) & O_APPEND))
+        return COPY_FILE_RANGE;
+    if (S_ISREG(in_st.st_mode))
+        return COPY_SENDFILE;
+    return COPY_READ_WRITE;
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// interruptible: the foreground's Ctrl-C stops the copy. A worker thread never
+// looks, since the interrupt belongs to whatever runs in the foreground
+static int copy_read_write(int in_fd, int out_fd, bool interruptible)
+{
+    char buf[65536];
+    while (true)
+    {
+        ssize_t n = read(in_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return (int)n;
+        if (write_all(out_fd, buf, n) < 0)
+            return -1;
+        if (interruptible && take_interrupt())
+            return 1;
+    }
+}
+
+// copy everything from in_fd to out_fd; 0 on success, 1 if Ctrl-C stopped it,
+// -1 with errno set
+static int copy_fd(int in_fd, int out_fd, bool interruptible)
+{
+    copy_method_t method = pick_method(in_fd, out_fd);
+
+    while (method != COPY_READ_WRITE)
+    {
+        ssize_t n;
+        if (method == COPY_SPLICE)
+            n = splice(in_fd, NULL, out_fd, NULL, CAT_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+        else if (method == COPY_FILE_RANGE)
+            n = copy_file_range(in_fd, NULL, out_fd, NULL, CAT_CHUNK, 0);
+        else
+            n = sendfile(out_fd, in_fd, NULL, CAT_CHUNK);
+
+        if (n == 0)
+            return 0;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // this pair of fds can't do it (old kernel, filesystem, tty...):
+            // the file offsets are where we left off, so just carry on by hand
+            if (errno == EINVAL || errno == ENOSYS || errno == EXDEV ||
+                errno == EOPNOTSUPP || errno == EBADF)
+            {
+                method = COPY_READ_WRITE;
+                break;
+            }
+            return -1;
+        }
+        if (interruptible && take_interrupt())
+            return 1;
+    }
+    return copy_read_write(in_fd, out_fd, interruptible);
+}
+
+static int copy_files(char **args, FILE *out, bool interruptible)
+{
+    fflush(out);
+    int out_fd = fileno(out);
+    int status = 0;
+    char *stdin_only[] = {"-", NULL};
+    char **files = args[1] ? args + 1 : stdin_only;
+
+    for (int i = 0; files[i]; i++)
+    {
+        bool from_stdin = strcmp(files[i], "-") == 0;
+        int in_fd = from_stdin ? STDIN_FILENO : open(files[i], O_RDONLY | O_CLOEXEC);
+        if (in_fd < 0)
+        {
+            fprintf(stderr, "cat: %s: %s\n", files[i], strerror(errno));
+            status = 1;
+            continue;
+        }
+
+        bool reader_gone = false;
+        int copied = copy_fd(in_fd, out_fd, interruptible);
+        if (copied > 0)
+        {
+            // interrupted, like an external command killed by SIGINT
+            if (!from_stdin)
+                close(in_fd);
+            return 128 + SIGINT;
+        }
+        if (copied < 0)
+        {
+            // a reader that went away is not worth a message
+            reader_gone = errno == EPIPE;
+            if (!reader_gone)
+                fprintf(stderr, "cat: %s: %s\n", files[i], strerror(errno));
+            status = 1;
+        }
+        if (!from_stdin)
+            close(in_fd);
+        if (reader_gone)
+            break;
+    }
+    return status;
+}
+
+void execute_cat(char **args, FILE *out)
+{
+    int status = copy_files(args, out, true);
+    if (status)
+        last_exit_status = status;
+}
+
+int cat_in_thread(char **args, FILE *out)
+{
+    return copy_files(args, out, false);
+}
@@ -1,216 +1,333 @@
+// wait4 is a BSD interface, memfd_create a Linux one
+#define _GNU_SOURCE
 #include "exec.h"
 #include "jobs.h"
 #include "parser.h"
+#include "spawner.h"
+#include "timing.h"
+#include "launch.h"
+#include "fanout.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <string.h>
 #include <stdbool.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <ctype.h>
 
 pid_t current_fg_pid = -1;
+bool exec_in_place = false;
+int last_exit_status = 0;
 
-// return 0 on success, -1 on failure (and print the required message)
-int validate_redirections(command_t *cmd)
+// shell-style exit code: the exit status, or 128 + the signal number
+int exit_code_from_status(int status)
+{
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    if (WIFSTOPPED(status))
+        return 128 + WSTOPSIG(status);
+    return 0;
+}
+
+// a single plain command may replace the process that runs it: no ";", "|"
+// or "&" to come back for, and no "time" waiting to print its report
+bool can_exec_in_place(const char *line)
+{
+    if (strpbrk(line, ";|&"))
+        return false;
+    while (isspace((unsigned char)*line))
+        line++;
+    return !(strncmp(line, "time", 4) == 0 &&
+             (line[4] == '\0' || isspace((unsigned char)line[4])));
+}
+
+void close_redirections(redir_t *redir)
+{
+    if (redir->in_fd >= 0)
+        close(redir->in_fd);
+    if (redir->out_fd >= 0)
+        close(redir->out_fd);
+    redir->in_fd = -1;
+    redir->out_fd = -1;
+    if (redir->fanout)
+        fanout_release(redir->fanout);
+    redir->fanout = NULL;
+}
+
+void wait_redirections(redir_t *redir)
+{
+    struct fanout *fanout = redir->fanout;
+    redir->fanout = NULL;
+    close_redirections(redir);
+    if (fanout)
+        fanout_wait(fanout);
+}
+
+// a here-document or here-string: the text goes into an anonymous memory
+// file, so nothing touches the disk and there is no writer to fork
+static int open_here_text(const char *text)
+{
+    int fd = memfd_create("heredoc", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("memfd_create");
+        return -1;
+    }
+    size_t len = strlen(text), off = 0;
+    while (off < len)
+    {
+        ssize_t n = write(fd, text + off, len - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            perror("heredoc");
+            close(fd);
+            return -1;
+        }
+        off += n;
+    }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+// open every "<" file (catches EACCES and ENOENT) and keep the last one
+static int open_inputs(command_t *cmd, int *in_fd)
 {
-    //validate ALL input files (open & close — catches EACCES and ENOENT)
     for (int i = 0; i < cmd->in_count; ++i)
     {
-        int fd = open(cmd->in_files[i], O_RDONLY);
+        if (cmd->in_here[i])
+        {
+            int fd = open_here_text(cmd->in_files[i]);
+            if (fd < 0)
+            {
+                if (*in_fd >= 0)
+                    close(*in_fd);
+                *in_fd = -1;
+                return -1;
+            }
+            if (*in_fd >= 0)
+                close(*in_fd);
+            *in_fd = fd;
+            continue;
+        }
+
+        int fd = open(cmd->in_files[i], O_RDONLY | O_CLOEXEC);
         if (fd < 0)
         {
             // tests expect this exact string
             printf("No such file or directory\n");
+            if (*in_fd >= 0)
+                close(*in_fd);
+            *in_fd = -1;
             return -1;
         }
-        close(fd);
+        if (*in_fd >= 0)
+            close(*in_fd);
+        *in_fd = fd;
     }
+    return 0;
+}
 
-    //validate ALL output files. If any open fails, close previous fds and unlink
-    //    only files we actually created during validation (don't unlink pre-existing files)
+// create/truncate every ">"/">>" file; with more than one, output goes to all
+// of them through a fan-out relay. If any open fails, unlink only files we
+// actually created here (don't unlink pre-existing files)
+static int open_outputs(command_t *cmd, redir_t *redir)
+{
     if (cmd->out_count == 0)
         return 0;
 
     int outc = cmd->out_count;
-    int *fds = calloc(outc, sizeof(int));
-    bool *existed_before = calloc(outc, sizeof(bool));
-    char **maybe_new_paths = calloc(outc, sizeof(char *));
-    if (!fds || !existed_before || !maybe_new_paths)
+    int *fds = malloc(outc * sizeof(int));
+    bool *created = calloc(outc, sizeof(bool));
+    if (!fds || !created)
     {
         free(fds);
-        free(existed_before);
-        free(maybe_new_paths);
+        free(created);
         // on allocation failure, fail safe by refusing to run command
         printf("Unable to create file for writing\n");
         return -1;
     }
 
     struct stat st;
-    int failed = 0;
-    for (int i = 0; i < outc; ++i)
+    int opened = 0;
+    for (; opened < outc; ++opened)
     {
-        const char *p = cmd->out_files[i];
-        existed_before[i] = (stat(p, &st) == 0);
-        int flags = O_WRONLY | O_CREAT | (cmd->out_append[i] ? O_APPEND : O_TRUNC);
+        const char *p = cmd->out_files[opened];
+        bool existed_before = (stat(p, &st) == 0);
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (cmd->out_append[opened] ? O_APPEND : O_TRUNC);
         int fd = open(p, flags, 0666);
         if (fd < 0)
-        {
-            failed = 1;
             break;
+        fds[opened] = fd;
+        created[opened] = !existed_before;
+    }
+
+    // several targets (zsh's MULTIOS): the command gets the relay's pipe
+    if (opened == outc && outc > 1)
+    {
+        redir->fanout = fanout_start(fds, cmd->out_append, outc, &redir->out_fd);
+        if (redir->fanout)
+        {
+            free(fds);
+            free(created);
+            return 0;
         }
-        fds[i] = fd;
-        // remember path only if we created it (so we can unlink it on failure)
-        maybe_new_paths[i] = existed_before[i] ? NULL : strdup(p);
     }
 
-    if (failed)
+    if (opened < outc || outc > 1)
     {
-        // close fds and unlink *only* those files we created during validation
-        for (int j = 0; j < outc; ++j)
+        for (int j = 0; j < opened; ++j)
         {
-            if (fds[j] > 0)
-                close(fds[j]);
-            if (maybe_new_paths[j])
-            {
-                unlink(maybe_new_paths[j]);
-                free(maybe_new_paths[j]);
-            }
+            close(fds[j]);
+            if (created[j])
+                unlink(cmd->out_files[j]);
         }
         free(fds);
-        free(existed_before);
-        free(maybe_new_paths);
+        free(created);
         // tests expect this exact string
         printf("Unable to create file for writing\n");
         return -1;
     }
 
-    // success: close validation fds and free memory (do NOT unlink)
-    for (int i = 0; i < outc; ++i)
+    redir->out_fd = fds[0];
+    free(fds);
+    free(created);
+    return 0;
+}
+
+int open_redirections(command_t *cmd, int which, redir_t *redir)
+{
+    redir->in_fd = -1;
+    redir->out_fd = -1;
+    redir->fanout = NULL;
+
+    if ((which & REDIR_INPUT) && open_inputs(cmd, &redir->in_fd) < 0)
+        return -1;
+    if ((which & REDIR_OUTPUT) && open_outputs(cmd, redir) < 0)
     {
-        if (fds[i] > 0)
-            close(fds[i]);
-        if (maybe_new_paths[i])
-        {
-            free(maybe_new_paths[i]);
-        }
+        close_redirections(redir);
+        return -1;
     }
-    free(fds);
-    free(existed_before);
-    free(maybe_new_paths);
     return 0;
 }
 
+// return 0 on success, -1 on failure (and print the required message)
+int validate_redirections(command_t *cmd, redir_t *redir)
+{
+    return open_redirections(cmd, REDIR_INPUT | REDIR_OUTPUT, redir);
+}
+
 void execute_command(command_t *cmd)
 {
     if (!cmd || cmd->argc == 0)
         return;
         
-    // validate redirections before fork
-    if (validate_redirections(cmd) < 0)
+    // validate redirections before spawning; the fds we get back go straight to the child
+    redir_t redir;
+    if (validate_redirections(cmd, &redir) < 0)
     {
-        return; // abort without fork
+        last_exit_status = 1;
+        return; // abort without spawning
     }
     
-    // Build full command string for job tracking
-    char full_cmd[1024] = "";
+    // Build full command string for job tracking, however long the argument list
+    size_t full_len = 1;
+    for (int i = 0; i < cmd->argc; i++)
+        full_len += strlen(cmd->argv[i]) + 1;
+    char *full_cmd = malloc(full_len);
+    if (!full_cmd)
+    {
+        perror("malloc");
+        close_redirections(&redir);
+        return;
+    }
+    char *end = full_cmd;
+    *end = '\0';
     for (int i = 0; i < cmd->argc; i++) {
-        if (i > 0) strcat(full_cmd, " ");
-        strcat(full_cmd, cmd->argv[i]);
+        if (i > 0) *end++ = ' ';
+        end = stpcpy(end, cmd->argv[i]);
     }
     
-    pid_t pid = fork();
+    spawn_request_t req;
+    spawn_request_init(&req, cmd->argv);
+    req.null_stdin = cmd->background;
+    req.in_fd = redir.in_fd;
+    req.out_fd = redir.out_fd;
+    req.attrs = launch_attrs_for(cmd->background);
+
+    // batch mode's last command: nothing left for the shell to do, so become it
+    if (exec_in_place && !cmd->background && job_count == 0 && !redir.fanout)
+    {
+        fflush(stdout);
+        spawn_exec_in_place(&req);
+        exit(spawn_report_failure(cmd->argv[0], errno));
+    }
+
+    double started = timing_now();
+    pid_t pid = spawn_process(&req);
+    int spawn_errno = errno;
+
     if (pid < 0)
     {
-        perror("fork failed");
+        close_redirections(&redir);
+        last_exit_status = spawn_report_failure(cmd->argv[0], spawn_errno);
+        free(full_cmd);
         return;
     }
     
-    if (pid == 0)
+    if (!cmd->background)
     {
-        //child
-        setpgid(0, 0);
+        setpgid(pid, pid);
+        tcsetpgrp(STDIN_FILENO, pid);
         
-        if (cmd->background)
-        {
-            int dn = open("/dev/null", O_RDONLY);
-            if (dn >= 0)
-            {
-                dup2(dn, STDIN_FILENO);
-                close(dn);
-            }
-        }
+        // set both fg_pid variables
+        extern pid_t fg_pid;
+        fg_pid = pid;
+        current_fg_pid = pid;
         
-        // handle input redirection - last input wins
-        if (cmd->in_count > 0)
+        // wait4 so "time" gets the child's resource usage for free
+        int status = 0;
+        struct rusage ru;
+        memset(&ru, 0, sizeof(ru));
+        pid_t reaped;
+        do
         {
-            char *infile = cmd->in_files[cmd->in_count - 1];
-            int fd_in = open(infile, O_RDONLY);
-            if (fd_in < 0)
-            {
-                printf("No such file or directory\n");
-                exit(EXIT_FAILURE);
-            }
-            dup2(fd_in, STDIN_FILENO);
-            close(fd_in);
-        }
-        
-        // handle output redirection - last output wins
-        if (cmd->out_count > 0)
+            reaped = wait4(pid, &status, WUNTRACED, &ru);
+        } while ((reaped < 0 && errno == EINTR) ||
+                 (reaped > 0 && !WIFEXITED(status) &&
+                  !WIFSIGNALED(status) &&
+                  !WIFSTOPPED(status)));
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+        timing_record(cmd->argv[0], timing_now() - started, &ru);
+        last_exit_status = exit_code_from_status(status);
+
+        // Ctrl-Z: keep it in the job table so fg/bg can pick it up
+        if (reaped > 0 && WIFSTOPPED(status))
         {
-            char *outfile = cmd->out_files[cmd->out_count - 1];
-            int flags = O_WRONLY | O_CREAT |
-                       (cmd->out_append[cmd->out_count - 1] ? O_APPEND : O_TRUNC);
-            int fd_out = open(outfile, flags, 0666);
-            if (fd_out < 0)
-            {
-                printf("Unable to create file for writing\n");
-                exit(EXIT_FAILURE);
-            }
-            dup2(fd_out, STDOUT_FILENO);
-            close(fd_out);
+            jobs_add_group(pid, &pid, 1, full_cmd, STOPPED);
+            close_redirections(&redir);
         }
+        else
+            wait_redirections(&redir);
         
-        // exec the program
-        if (execvp(cmd->argv[0], cmd->argv) == -1)
-        {
-            fprintf(stderr, "Command not found!\n");
-            exit(EXIT_FAILURE);
-        }
+        // clear both fg_pid variables
+        fg_pid = -1;
+        current_fg_pid = -1;
     }
     else
     {
-        //parent
-        if (!cmd->background)
-        {
-            setpgid(pid, pid);
-            tcsetpgrp(STDIN_FILENO, pid);
-            
-            // set both fg_pid variables
-            extern pid_t fg_pid;
-            fg_pid = pid;
-            current_fg_pid = pid;
-            
-            int status;
-            do
-            {
-                waitpid(pid, &status, WUNTRACED);
-            } while (!WIFEXITED(status) &&
-                    !WIFSIGNALED(status) &&
-                    !WIFSTOPPED(status));
-            tcsetpgrp(STDIN_FILENO, getpgrp());
-            
-            // clear both fg_pid variables
-            fg_pid = -1;
-            current_fg_pid = -1;
-        }
-        else
-        {
-            
-            setpgid(pid, pid);
-            jobs_add(pid, full_cmd);  // Use full command string instead of just cmd->argv[0]
-        }
+        setpgid(pid, pid);
+        close_redirections(&redir);
+        jobs_add(pid, full_cmd);
+        last_exit_status = 0;  // Use full command string instead of just cmd->argv[0]
     }
+    free(full_cmd);
 }
\ No newline at end of file
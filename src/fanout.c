@@ -0,0 +1,263 @@
+// tee and splice are Linux interfaces
+#define _GNU_SOURCE
+#include "fanout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#define FANOUT_CHUNK (1 << 20)
+#define COPY_BUFFER (64 * 1024)
+
+typedef struct {
+    int fd;
+    bool copy;      // splice refuses O_APPEND files and some devices: read/write instead
+    bool failed;    // a write error; the data for it is dropped from then on
+    int pipe[2];    // tee target, -1 for the one that consumes the source pipe
+} fanout_target_t;
+
+struct fanout {
+    pthread_t thread;
+    int src;
+    int count;
+    fanout_target_t *targets;
+    char *buffer;
+
+    // the relay and the handle's owner each hold a reference
+    int refs;
+    bool done;
+};
+
+static pthread_mutex_t fanout_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fanout_done = PTHREAD_COND_INITIALIZER;
+static int active_relays = 0;
+
+static void fanout_free(fanout_t *fanout)
+{
+    for (int i = 0; i < fanout->count; i++)
+    {
+        fanout_target_t *t = &fanout->targets[i];
+        close(t->fd);
+        if (t->pipe[0] >= 0)
+        {
+            close(t->pipe[0]);
+            close(t->pipe[1]);
+        }
+    }
+    if (fanout->src >= 0)
+        close(fanout->src);
+    free(fanout->targets);
+    free(fanout->buffer);
+    free(fanout);
+}
+
+static void fanout_unref(fanout_t *fanout)
+{
+    pthread_mutex_lock(&fanout_lock);
+    bool last = --fanout->refs == 0;
+    pthread_mutex_unlock(&fanout_lock);
+    if (last)
+        fanout_free(fanout);
+}
+
+// move exactly len bytes out of the pipe `from` into the target (or nowhere,
+// once it has failed). Returns -1 only if the pipe itself can't be read
+static int drain(fanout_t *fanout, int from, fanout_target_t *t, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n;
+        if (!t->failed && !t->copy)
+        {
+            n = splice(from, NULL, t->fd, NULL, len, SPLICE_F_MOVE);
+            if (n < 0 && errno == EINVAL)
+            {
+                t->copy = true;
+                continue;
+            }
+        }
+        else
+        {
+            n = read(from, fanout->buffer, len < COPY_BUFFER ? len : COPY_BUFFER);
+            for (ssize_t off = 0; n > 0 && !t->failed && off < n;)
+            {
+                ssize_t w = write(t->fd, fanout->buffer + off, n - off);
+                if (w < 0 && errno == EINTR)
+                    continue;
+                if (w < 0)
+                {
+                    perror("fanout: write");
+                    t->failed = true;
+                    break;
+                }
+                off += w;
+            }
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && !t->failed && !t->copy)
+        {
+            // the file side failed (ENOSPC, EPIPE, ...); keep emptying the pipe
+            perror("fanout: write");
+            t->failed = true;
+            continue;
+        }
+        if (n <= 0)
+            return -1;
+        len -= n;
+    }
+    return 0;
+}
+
+static void *relay_main(void *arg)
+{
+    fanout_t *fanout = arg;
+    // every target but the last gets a tee'd copy of what the source holds,
+    // then the last one consumes it. All pipes are drained each round, so a
+    // tee always has room for everything the source had
+    fanout_target_t *consumer = &fanout->targets[fanout->count - 1];
+
+    while (true)
+    {
+        ssize_t len = tee(fanout->src, fanout->targets[0].pipe[1], FANOUT_CHUNK, 0);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0)
+            break;
+
+        bool ok = true;
+        for (int i = 1; ok && i < fanout->count - 1; i++)
+        {
+            ssize_t n;
+            while ((n = tee(fanout->src, fanout->targets[i].pipe[1], len, 0)) < 0 && errno == EINTR)
+                ;
+            ok = n == len;
+        }
+        for (int i = 0; ok && i < fanout->count - 1; i++)
+            ok = drain(fanout, fanout->targets[i].pipe[0], &fanout->targets[i], len) == 0;
+        if (!ok || drain(fanout, fanout->src, consumer, len) < 0)
+        {
+            perror("fanout");
+            break;
+        }
+    }
+
+    // close the source now so a writer that is still going sees EPIPE rather than hanging
+    close(fanout->src);
+    fanout->src = -1;
+
+    pthread_mutex_lock(&fanout_lock);
+    fanout->done = true;
+    active_relays--;
+    pthread_cond_broadcast(&fanout_done);
+    pthread_mutex_unlock(&fanout_lock);
+    fanout_unref(fanout);
+    return NULL;
+}
+
+fanout_t *fanout_start(const int *fds, const bool *append, int count, int *write_fd)
+{
+    int src[2];
+    fanout_t *fanout = calloc(1, sizeof(fanout_t));
+    if (!fanout || pipe2(src, O_CLOEXEC) < 0)
+    {
+        free(fanout);
+        return NULL;
+    }
+    fanout->src = src[0];
+    fanout->count = count;
+    fanout->refs = 2;
+    fanout->targets = calloc(count, sizeof(fanout_target_t));
+    fanout->buffer = malloc(COPY_BUFFER);
+
+    bool ok = fanout->targets && fanout->buffer;
+    for (int i = 0; ok && i < count; i++)
+    {
+        fanout->targets[i].fd = fds[i];
+        fanout->targets[i].copy = append[i];
+        fanout->targets[i].pipe[0] = fanout->targets[i].pipe[1] = -1;
+    }
+    int capacity = fcntl(src[1], F_GETPIPE_SZ);
+    for (int i = 0; ok && i < count - 1; i++)
+    {
+        int *p = fanout->targets[i].pipe;
+        ok = pipe2(p, O_CLOEXEC) == 0;
+        // a tee must never come up short
+        if (ok && fcntl(p[1], F_SETPIPE_SZ, capacity) < 0)
+            ok = false;
+    }
+
+    sigset_t all, old;
+    sigfillset(&all);
+    if (ok)
+    {
+        pthread_mutex_lock(&fanout_lock);
+        active_relays++;
+        pthread_mutex_unlock(&fanout_lock);
+
+        // no signals for the relay; a target that went away is just EPIPE
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        ok = pthread_create(&fanout->thread, NULL, relay_main, fanout) == 0;
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+        if (!ok)
+        {
+            pthread_mutex_lock(&fanout_lock);
+            active_relays--;
+            pthread_mutex_unlock(&fanout_lock);
+        }
+    }
+
+    if (!ok)
+    {
+        // the caller still owns fds
+        if (fanout->targets)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (fanout->targets[i].pipe[0] >= 0)
+                {
+                    close(fanout->targets[i].pipe[0]);
+                    close(fanout->targets[i].pipe[1]);
+                }
+            }
+        }
+        close(src[0]);
+        close(src[1]);
+        free(fanout->targets);
+        free(fanout->buffer);
+        free(fanout);
+        return NULL;
+    }
+
+    pthread_detach(fanout->thread);
+    *write_fd = src[1];
+    return fanout;
+}
+
+void fanout_wait(fanout_t *fanout)
+{
+    pthread_mutex_lock(&fanout_lock);
+    while (!fanout->done)
+        pthread_cond_wait(&fanout_done, &fanout_lock);
+    pthread_mutex_unlock(&fanout_lock);
+    fanout_unref(fanout);
+}
+
+void fanout_release(fanout_t *fanout)
+{
+    fanout_unref(fanout);
+}
+
+int fanout_active(void)
+{
+    pthread_mutex_lock(&fanout_lock);
+    int n = active_relays;
+    pthread_mutex_unlock(&fanout_lock);
+    return n;
+}
@@ -3,3 +3,6 @@
 
 // define once here
 char prev_dir[PATH_MAX] = "";
+
+// the directory the shell was started in; "~" for hop, reveal and log
+char home_dir[1024];
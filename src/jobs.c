@@ -1,4 +1,6 @@
 #include "jobs.h"
+#include "builtins.h"
+#include "parser.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,28 +10,56 @@
 #include <errno.h>
 #include <limits.h>   // for PATH_MAX
 
-// a global array to store my job list
+// a global array to store my job list; grows as needed
 static int next_job_id = 1;
 
-job_t job_list[1024];
+job_t *job_list = NULL;
 int job_count = 0;
+static int job_capacity = 0;
 
-// a helper function to find a job by its pid
+// in-process jobs still running; lets the prompt loop skip the scan when zero
+static int tasks_running = 0;
+
+// admission control state. job_limit 0 means no limit
+static int job_limit = 0;
+static int queued_count = 0;
+static void (*launch_line)(char *) = NULL;
+// set while a queued line is being started: it must not queue itself again,
+// and its first job takes over the id it was queued under
+static bool admitting = false;
+static int reserved_job_id = 0;
+
+// a helper function to find a job by its pid: the group id or any member's pid
 static job_t *find_job_by_pid(pid_t pid)
 {
     for (int i = 0; i < job_count; i++)
     {
+        if (job_list[i].state == QUEUED)
+            continue;
         if (job_list[i].pid == pid)
-        {
             return &job_list[i];
-        }
+        for (int m = 0; m < job_list[i].member_count; m++)
+            if (job_list[i].members[m] == pid)
+                return &job_list[i];
     }
     return NULL;
 }
 
+static void free_heredocs(char **heredocs, int count)
+{
+    for (int i = 0; i < count; i++)
+        free(heredocs[i]);
+    free(heredocs);
+}
+
 // a helper function to remove a job from the list when it is done
 static void remove_job(int index)
 {
+    if (job_list[index].state == QUEUED)
+        queued_count--;
+    free(job_list[index].command);
+    free(job_list[index].members);
+    free_heredocs(job_list[index].heredocs, job_list[index].heredoc_count);
     for (int i = index; i < job_count - 1; i++)
     {
         job_list[i] = job_list[i + 1];
@@ -37,54 +67,303 @@ static void remove_job(int index)
     job_count--;
 }
 
+static job_t *new_job(const char *command)
+{
+    if (job_count == job_capacity)
+    {
+        int cap = job_capacity ? job_capacity * 2 : 64;
+        job_t *grown = realloc(job_list, cap * sizeof(job_t));
+        if (!grown)
+            return NULL;
+        job_list = grown;
+        job_capacity = cap;
+    }
+    char *copy = strdup(command);
+    if (!copy)
+        return NULL;
+
+    job_t *job = &job_list[job_count++];
+    job->command = copy;
+    job->task = NULL;
+    job->pid = 0;
+    job->state = RUNNING;
+    job->members = NULL;
+    job->member_count = 0;
+    job->last_member = 0;
+    job->last_status = 0;
+    job->heredocs = NULL;
+    job->heredoc_count = 0;
+    if (reserved_job_id)
+    {
+        job->job_id = reserved_job_id;
+        reserved_job_id = 0;
+    }
+    else
+    {
+        job->job_id = next_job_id++;
+    }
+    return job;
+}
+
 // this function adds a new job to my job list
 void jobs_add(pid_t pid, char *command)
 {
-    if (job_count >= 1024)
+    jobs_add_group(pid, &pid, 1, command, RUNNING);
+    // printf("[%d] %d\n", job_list[job_count - 1].job_id, pid);
+}
+
+void jobs_add_group(pid_t pgid, const pid_t *pids, int count, const char *command, job_state_t state)
+{
+    pid_t *members = malloc(count * sizeof(pid_t));
+    job_t *job = members ? new_job(command) : NULL;
+    if (!job)
     {
-        // no space left for more jobs
+        free(members);
+        perror("jobs");
         return;
     }
-    job_list[job_count].pid = pid;
-    job_list[job_count].state = RUNNING;
-    strcpy(job_list[job_count].command, command);
-    job_list[job_count].job_id = next_job_id++;
-    job_count++;
-    // printf("[%d] %d\n", job_list[job_count - 1].job_id, pid);
+    memcpy(members, pids, count * sizeof(pid_t));
+    job->pid = pgid;
+    job->members = members;
+    job->member_count = count;
+    job->last_member = pids[count - 1];
+    job->state = state;
+    if (state == STOPPED)
+        printf("\n[%d] Stopped %s\n", job->job_id, job->command);
+}
+
+bool jobs_member_done(job_t *job, pid_t pid, int status)
+{
+    for (int m = 0; m < job->member_count; m++)
+    {
+        if (job->members[m] == pid)
+        {
+            job->members[m] = job->members[--job->member_count];
+            break;
+        }
+    }
+    if (pid == job->last_member)
+        job->last_status = status;
+    return job->member_count == 0;
+}
+
+// in-process jobs show the shell's own pid, which is where they run
+void jobs_add_task(struct bg_task *task, char *command)
+{
+    job_t *job = new_job(command);
+    if (!job)
+    {
+        // no slot: wait for it here rather than lose track of the thread
+        bg_task_finish(task);
+        return;
+    }
+    job->pid = getpid();
+    job->task = task;
+    tasks_running++;
+}
+
+// report in-process jobs whose worker has finished
+bool jobs_reap_tasks(void)
+{
+    if (tasks_running == 0)
+        return false;
+
+    bool printed = false;
+    for (int i = 0; i < job_count;)
+    {
+        job_t *job = &job_list[i];
+        if (job->task && bg_task_done(job->task))
+        {
+            bg_task_finish(job->task);
+            tasks_running--;
+            printf("[%d] %s with pid %d exited normally\n", job->job_id, job->command, job->pid);
+            fflush(stdout);
+            jobs_remove_by_index(i);
+            printed = true;
+            continue;
+        }
+        i++;
+    }
+    return printed;
+}
+
+// logout/EOF: kill child jobs, wait out in-process ones (they can't be killed)
+void jobs_kill_all(void)
+{
+    for (int i = 0; i < job_count; i++)
+    {
+        if (job_list[i].task)
+        {
+            bg_task_finish(job_list[i].task);
+            job_list[i].task = NULL;
+            tasks_running--;
+        }
+        else if (job_list[i].state != QUEUED)
+        {
+            kill(-job_list[i].pid, SIGKILL);
+        }
+    }
+}
+
+// a forked subshell inherits our table but none of those jobs are its own
+void jobs_forget_all(void)
+{
+    job_count = 0;
+    tasks_running = 0;
+    queued_count = 0;
 }
 
 void jobs_remove_by_index(int index)
 {
     if (index < 0 || index >= job_count)
         return;
-    for (int i = index; i < job_count - 1; i++)
+    remove_job(index);
+}
+
+void jobs_set_launcher(void (*run_command)(char *))
+{
+    launch_line = run_command;
+}
+
+void jobs_set_limit(int limit)
+{
+    job_limit = limit;
+    // a raised limit lets waiting jobs go right away
+    jobs_admit_queued();
+}
+
+void jobs_print_limit(void)
+{
+    int running = 0;
+    for (int i = 0; i < job_count; i++)
+        if (job_list[i].state == RUNNING)
+            running++;
+    if (job_limit > 0)
+        printf("limit: %d, running: %d, queued: %d\n", job_limit, running, queued_count);
+    else
+        printf("limit: none, running: %d, queued: %d\n", running, queued_count);
+}
+
+// stopped jobs hold no CPU, so only running ones count against the limit
+static int running_jobs(void)
+{
+    int running = 0;
+    for (int i = 0; i < job_count; i++)
+        if (job_list[i].state == RUNNING)
+            running++;
+    return running;
+}
+
+bool jobs_should_queue(void)
+{
+    if (job_limit <= 0 || admitting)
+        return false;
+    // first come, first served: nothing jumps ahead of what is already waiting
+    return queued_count > 0 || running_jobs() >= job_limit;
+}
+
+// line is the whole "cmd ... &" line; the job shows it without the "&"
+void jobs_queue(const char *line, char *const *heredocs, int heredoc_count)
+{
+    char *command = strdup(line);
+    if (!command)
+        return;
+    size_t len = strlen(command);
+    while (len > 0 && (command[len - 1] == '&' || command[len - 1] == ' ' || command[len - 1] == '\t'))
+        command[--len] = '\0';
+
+    job_t *job = new_job(command);
+    free(command);
+    if (!job)
     {
-        job_list[i] = job_list[i + 1];
+        perror("jobs");
+        return;
     }
-    job_count--;
+    job->state = QUEUED;
+    queued_count++;
+    // the reader's queue is empty by the time the job starts: keep its bodies
+    if (heredoc_count > 0 && (job->heredocs = malloc(heredoc_count * sizeof(char *))))
+    {
+        for (int i = 0; i < heredoc_count; i++)
+            if ((job->heredocs[job->heredoc_count] = strdup(heredocs[i])))
+                job->heredoc_count++;
+    }
+    printf("[%d] queued\n", job->job_id);
+}
+
+int jobs_queued(void)
+{
+    return queued_count;
+}
+
+int jobs_tasks_running(void)
+{
+    return tasks_running;
 }
 
-// a function to check for completed background children
-void reap_background_children(void)
+// start a queued job through the command driver, foreground or as "&"
+static void start_queued(int index, bool background)
 {
-    pid_t pid;
-    int status;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    int job_id = job_list[index].job_id;
+    char *command = job_list[index].command;
+    char **heredocs = job_list[index].heredocs;
+    int heredoc_count = job_list[index].heredoc_count;
+    job_list[index].command = NULL;
+    job_list[index].heredocs = NULL;
+    job_list[index].heredoc_count = 0;
+    remove_job(index);
+
+    size_t len = strlen(command);
+    char *line = malloc(len + 3);
+    if (line)
     {
-        job_t *job = find_job_by_pid(pid);
-        if (job)
+        memcpy(line, command, len);
+        strcpy(line + len, background ? " &" : "");
+        // the line's own bodies, in place of whatever the reader has queued
+        heredoc_queue_t saved;
+        heredoc_save(&saved);
+        for (int i = 0; i < heredoc_count; i++)
         {
-            printf("[%d] %s with pid %d exited normally\n", job->job_id, job->command, job->pid);
-            jobs_remove_by_index(job - job_list);
+            heredoc_push(heredocs[i]);
+            heredocs[i] = NULL;
         }
+        admitting = true;
+        reserved_job_id = job_id;
+        launch_line(line);
+        reserved_job_id = 0;
+        admitting = false;
+        heredoc_restore(&saved);
+        free(line);
+    }
+    free(command);
+    free_heredocs(heredocs, heredoc_count);
+}
+
+// called after children are reaped: start waiting jobs, oldest first, while
+// there is room under the limit. returns true if anything was started
+bool jobs_admit_queued(void)
+{
+    bool started = false;
+    while (queued_count > 0 && launch_line && (job_limit <= 0 || running_jobs() < job_limit))
+    {
+        int oldest = -1;
+        for (int i = 0; i < job_count; i++)
+            if (job_list[i].state == QUEUED && (oldest < 0 || job_list[i].job_id < job_list[oldest].job_id))
+                oldest = i;
+        if (oldest < 0)
+            break;
+        start_queued(oldest, true);
+        started = true;
     }
+    return started;
 }
 
-// a function to mark a job as stopped when it receives SIGTSTP
+// a function to mark a job as stopped when it receives SIGTSTP; every stage of
+// a pipeline reports it, but the job is only announced once
 void jobs_mark_stopped(pid_t pid)
 {
     job_t *job = find_job_by_pid(pid);
-    if (job)
+    if (job && job->state != STOPPED)
     {
         job->state = STOPPED;
         printf("\n[%d] Stopped %s\n", job->job_id, job->command);
@@ -94,7 +373,15 @@ void jobs_mark_stopped(pid_t pid)
 // a function to ping a job with a signal
 void jobs_ping(pid_t pid, int sig_num)
 {
-    if (kill(pid, sig_num) == 0)
+    job_t *job = find_job_by_pid(pid);
+    if (job && job->task)
+    {
+        printf("Job [%d] runs inside the shell and cannot be signalled\n", job->job_id);
+        return;
+    }
+    // a job's pid reaches its whole process group, every stage of a pipeline at once
+    pid_t target = job ? -job->pid : pid;
+    if (kill(target, sig_num) == 0)
     {
         printf("Sent signal %d to process with pid %d\n", sig_num, pid);
     }
@@ -119,6 +406,11 @@ void jobs_print_activities(void)
     qsort(job_list, job_count, sizeof(job_t), cmp);
     for (int i = 0; i < job_count; i++)
     {
+        if (job_list[i].state == QUEUED)
+        {
+            printf("[%d] - : %s - Queued\n", job_list[i].job_id, job_list[i].command);
+            continue;
+        }
         const char *state_str = (job_list[i].state == RUNNING) ? "Running" : "Stopped";
         printf("[%d] %d : %s - %s\n",
                job_list[i].job_id, job_list[i].pid,
@@ -139,6 +431,23 @@ void jobs_fg(int job_id)
             // tell the user what command is running
             printf("%s\n", job_list[i].command);
 
+            // a queued job never started: run it here instead
+            if (job_list[i].state == QUEUED)
+            {
+                start_queued(i, false);
+                return;
+            }
+
+            // an in-process job: just wait for its worker
+            if (job_list[i].task)
+            {
+                fflush(stdout);
+                last_exit_status = bg_task_finish(job_list[i].task);
+                tasks_running--;
+                remove_job(i);
+                return;
+            }
+
             extern pid_t fg_pid;
             fg_pid = pid;
 
@@ -148,25 +457,47 @@ void jobs_fg(int job_id)
             // send a SIGCONT to the job to make it run again if it was stopped
             if (job_list[i].state == STOPPED)
             {
+                job_list[i].state = RUNNING;
                 kill(-pid, SIGCONT);
             }
 
-            // wait for the job to complete
-            int status;
-            do
+            // wait for every process in the group, or for it to stop again
+            while (true)
             {
-                waitpid(pid, &status, WUNTRACED);
-            } while (!WIFEXITED(status) && !WIFSIGNALED(status) && !WIFSTOPPED(status));
+                int status;
+                pid_t reaped = waitpid(-pid, &status, WUNTRACED);
+                if (reaped < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    // nothing left to wait for
+                    job_t *gone = jobs_find_by_id(job_id);
+                    if (gone)
+                        remove_job(gone - job_list);
+                    break;
+                }
+
+                job_t *job = jobs_find_by_id(job_id);
+                if (!job)
+                    break;
+                if (WIFSTOPPED(status))
+                {
+                    last_exit_status = exit_code_from_status(status);
+                    jobs_mark_stopped(reaped);
+                    break;
+                }
+                if (jobs_member_done(job, reaped, status))
+                {
+                    // the final stage's status, as for any foreground pipeline
+                    last_exit_status = exit_code_from_status(job->last_status);
+                    remove_job(job - job_list);
+                    break;
+                }
+            }
 
             // move the shell back to the foreground
             tcsetpgrp(STDIN_FILENO, getpgrp());
 
-            // remove the job from the list if it finished
-            if (WIFEXITED(status) || WIFSIGNALED(status))
-            {
-                remove_job(i);
-            }
-
             fg_pid = -1;
 
             return;
@@ -189,6 +520,11 @@ void jobs_bg(int job_id)
                 printf("Job already running\n");
                 return;
             }
+            if (job_list[i].state == QUEUED)
+            {
+                printf("Job is queued\n");
+                return;
+            }
             // send the SIGCONT signal to the stopped job to make it run again
             job_list[i].state = RUNNING;
             kill(-job_list[i].pid, SIGCONT);
@@ -205,19 +541,11 @@ pid_t get_foreground_pgid(void)
     return tcgetpgrp(STDIN_FILENO);
 }
 
-// helper: find job by pid (already have)
-// add: find by job_id
-job_t *jobs_find_by_pid(pid_t pid) {
-  for (int i = 0; i < job_count; i++) {
-    if (job_list[i].pid == pid) {
-      return &job_list[i];
-    }
-  }
-  return NULL;
+job_t *jobs_find_by_pid(pid_t pid)
+{
+    return find_job_by_pid(pid);
 }
 
-
-
 job_t *jobs_find_by_id(int job_id)
 {
     for (int i = 0; i < job_count; i++)
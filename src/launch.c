@@ -0,0 +1,407 @@
+// sched_setaffinity and CPU_SET are GNU interfaces
+#define _GNU_SOURCE
+#include "launch.h"
+#include "exec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+// glibc has no wrapper for ioprio_set
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+
+static launch_attrs_t session_attrs;
+static launch_attrs_t background_attrs;
+static launch_attrs_t prefix_attrs;
+static launch_attrs_t merged_attrs;
+
+static const struct {
+    const char *name;
+    int resource;
+} limit_names[] = {
+    {"as", RLIMIT_AS},
+    {"core", RLIMIT_CORE},
+    {"cpu", RLIMIT_CPU},
+    {"data", RLIMIT_DATA},
+    {"fsize", RLIMIT_FSIZE},
+    {"memlock", RLIMIT_MEMLOCK},
+    {"nofile", RLIMIT_NOFILE},
+    {"nproc", RLIMIT_NPROC},
+    {"stack", RLIMIT_STACK},
+};
+
+// fails to compile if a name is added without room for it in launch_attrs_t
+typedef char limit_names_fit[sizeof(limit_names) / sizeof(limit_names[0]) <= LAUNCH_MAX_LIMITS ? 1 : -1];
+
+static const char *io_class_names[] = {"none", "rt", "be", "idle"};
+
+static bool attrs_empty(const launch_attrs_t *a)
+{
+    return !a->has_cpus && !a->has_nice && !a->has_ioprio && a->limit_count == 0;
+}
+
+static bool set_limit(launch_attrs_t *a, int resource, rlim_t value)
+{
+    for (int i = 0; i < a->limit_count; i++)
+    {
+        if (a->limits[i].resource == resource)
+        {
+            a->limits[i].value = value;
+            return true;
+        }
+    }
+    if (a->limit_count == LAUNCH_MAX_LIMITS)
+        return false;
+    a->limits[a->limit_count].resource = resource;
+    a->limits[a->limit_count].value = value;
+    a->limit_count++;
+    return true;
+}
+
+// later layers override earlier ones field by field
+static void merge_attrs(launch_attrs_t *dst, const launch_attrs_t *src)
+{
+    if (src->has_cpus)
+    {
+        dst->has_cpus = true;
+        memcpy(dst->cpus, src->cpus, sizeof(dst->cpus));
+    }
+    if (src->has_nice)
+    {
+        dst->has_nice = true;
+        dst->nice = src->nice;
+    }
+    if (src->has_ioprio)
+    {
+        dst->has_ioprio = true;
+        dst->io_class = src->io_class;
+        dst->io_level = src->io_level;
+    }
+    for (int i = 0; i < src->limit_count; i++)
+        set_limit(dst, src->limits[i].resource, src->limits[i].value);
+}
+
+const launch_attrs_t *launch_attrs_for(bool background)
+{
+    memset(&merged_attrs, 0, sizeof(merged_attrs));
+    merge_attrs(&merged_attrs, &session_attrs);
+    if (background)
+        merge_attrs(&merged_attrs, &background_attrs);
+    merge_attrs(&merged_attrs, &prefix_attrs);
+    return attrs_empty(&merged_attrs) ? NULL : &merged_attrs;
+}
+
+void launch_apply(const launch_attrs_t *attrs)
+{
+    if (!attrs)
+        return;
+
+    if (attrs->has_cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < LAUNCH_MAX_CPUS && cpu < CPU_SETSIZE; cpu++)
+            if (attrs->cpus[cpu / 8] & (1u << (cpu % 8)))
+                CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0)
+            perror("launch: sched_setaffinity");
+    }
+    if (attrs->has_nice && setpriority(PRIO_PROCESS, 0, attrs->nice) < 0)
+        perror("launch: setpriority");
+    if (attrs->has_ioprio)
+    {
+        int prio = (attrs->io_class << IOPRIO_CLASS_SHIFT) | attrs->io_level;
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, prio) < 0)
+            perror("launch: ioprio_set");
+    }
+    for (int i = 0; i < attrs->limit_count; i++)
+    {
+        // only the soft limit moves, so the program may still raise it back
+        struct rlimit rl;
+        if (getrlimit(attrs->limits[i].resource, &rl) < 0)
+            continue;
+        rl.rlim_cur = attrs->limits[i].value;
+        if (rl.rlim_max != RLIM_INFINITY && (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > rl.rlim_max))
+            rl.rlim_cur = rl.rlim_max;
+        if (setrlimit(attrs->limits[i].resource, &rl) < 0)
+            perror("launch: setrlimit");
+    }
+}
+
+// "0-3,6" -> bitmap
+static bool parse_cpus(const char *s, launch_attrs_t *a)
+{
+    unsigned char cpus[sizeof(a->cpus)];
+    memset(cpus, 0, sizeof(cpus));
+
+    while (*s)
+    {
+        char *end;
+        long lo = strtol(s, &end, 10);
+        if (end == s || lo < 0)
+            return false;
+        long hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+            if (end == s || hi < lo)
+                return false;
+        }
+        if (hi >= LAUNCH_MAX_CPUS)
+            return false;
+        for (long cpu = lo; cpu <= hi; cpu++)
+            cpus[cpu / 8] |= 1u << (cpu % 8);
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return false;
+        s = end;
+    }
+
+    a->has_cpus = true;
+    memcpy(a->cpus, cpus, sizeof(cpus));
+    return true;
+}
+
+// "idle", "be:4", "rt:0" or the numeric class
+static bool parse_ioprio(const char *s, launch_attrs_t *a)
+{
+    const char *colon = strchr(s, ':');
+    size_t len = colon ? (size_t)(colon - s) : strlen(s);
+    int io_class = -1;
+    for (int c = 1; c <= 3; c++)
+        if (strlen(io_class_names[c]) == len && strncmp(s, io_class_names[c], len) == 0)
+            io_class = c;
+    if (io_class < 0 && len == 1 && s[0] >= '1' && s[0] <= '3')
+        io_class = s[0] - '0';
+    if (io_class < 0)
+        return false;
+
+    int level = 4;
+    if (colon)
+    {
+        char *end;
+        long v = strtol(colon + 1, &end, 10);
+        if (end == colon + 1 || *end != '\0' || v < 0 || v > 7)
+            return false;
+        level = (int)v;
+    }
+    a->has_ioprio = true;
+    a->io_class = io_class;
+    a->io_level = io_class == 3 ? 0 : level;
+    return true;
+}
+
+// "nofile=1024", "as=unlimited"
+static bool parse_limit(const char *s, launch_attrs_t *a)
+{
+    const char *eq = strchr(s, '=');
+    if (!eq)
+        return false;
+    size_t len = eq - s;
+    for (size_t i = 0; i < sizeof(limit_names) / sizeof(limit_names[0]); i++)
+    {
+        if (strlen(limit_names[i].name) != len || strncmp(s, limit_names[i].name, len) != 0)
+            continue;
+        rlim_t value;
+        if (strcmp(eq + 1, "unlimited") == 0)
+            value = RLIM_INFINITY;
+        else
+        {
+            char *end;
+            unsigned long long v = strtoull(eq + 1, &end, 10);
+            if (end == eq + 1 || *end != '\0')
+                return false;
+            value = (rlim_t)v;
+        }
+        return set_limit(a, limit_names[i].resource, value);
+    }
+    return false;
+}
+
+static void print_attrs(const char *label, const launch_attrs_t *a)
+{
+    printf("%s:", label);
+    if (attrs_empty(a))
+        printf(" (none)");
+    if (a->has_cpus)
+    {
+        printf(" cpus=");
+        bool first = true;
+        for (int cpu = 0; cpu < LAUNCH_MAX_CPUS; cpu++)
+        {
+            if (!(a->cpus[cpu / 8] & (1u << (cpu % 8))))
+                continue;
+            int last = cpu;
+            while (last + 1 < LAUNCH_MAX_CPUS && (a->cpus[(last + 1) / 8] & (1u << ((last + 1) % 8))))
+                last++;
+            printf(first ? "%d" : ",%d", cpu);
+            if (last > cpu)
+                printf("-%d", last);
+            first = false;
+            cpu = last;
+        }
+    }
+    if (a->has_nice)
+        printf(" nice=%d", a->nice);
+    if (a->has_ioprio)
+        printf(" io=%s:%d", io_class_names[a->io_class], a->io_level);
+    for (int i = 0; i < a->limit_count; i++)
+    {
+        const char *name = "?";
+        for (size_t n = 0; n < sizeof(limit_names) / sizeof(limit_names[0]); n++)
+            if (limit_names[n].resource == a->limits[i].resource)
+                name = limit_names[n].name;
+        if (a->limits[i].value == RLIM_INFINITY)
+            printf(" %s=unlimited", name);
+        else
+            printf(" %s=%llu", name, (unsigned long long)a->limits[i].value);
+    }
+    printf("\n");
+}
+
+// next whitespace-separated word, NUL-terminated in place
+static char *next_word(char **cursor)
+{
+    char *p = *cursor;
+    while (*p && isspace((unsigned char)*p))
+        p++;
+    if (*p == '\0')
+    {
+        *cursor = p;
+        return NULL;
+    }
+    char *word = p;
+    while (*p && !isspace((unsigned char)*p))
+        p++;
+    if (*p)
+        *p++ = '\0';
+    *cursor = p;
+    return word;
+}
+
+static void launch_usage(void)
+{
+    printf("Usage: launch [-c cpus] [-n nice] [-i class[:level]] [-l limit=value]... command\n");
+    printf("       launch -s|-b [-r] [options]   set session / background defaults\n");
+}
+
+void execute_launch(char *line, void (*run_command)(char *))
+{
+    launch_attrs_t opts;
+    memset(&opts, 0, sizeof(opts));
+    launch_attrs_t *target = NULL;
+    bool reset = false;
+    bool any_option = false;
+
+    char *cursor = line;
+    char *command = NULL;
+    while (true)
+    {
+        // peek: the command starts at the first word that isn't an option
+        char *p = cursor;
+        while (*p && isspace((unsigned char)*p))
+            p++;
+        if (*p == '\0')
+            break;
+        if (*p != '-')
+        {
+            command = p;
+            break;
+        }
+
+        char *opt = next_word(&cursor);
+        if (strcmp(opt, "--") == 0)
+        {
+            while (*cursor && isspace((unsigned char)*cursor))
+                cursor++;
+            command = *cursor ? cursor : NULL;
+            break;
+        }
+        if (strcmp(opt, "-s") == 0)
+        {
+            target = &session_attrs;
+            continue;
+        }
+        if (strcmp(opt, "-b") == 0)
+        {
+            target = &background_attrs;
+            continue;
+        }
+        if (strcmp(opt, "-r") == 0)
+        {
+            reset = true;
+            continue;
+        }
+
+        char *value = next_word(&cursor);
+        bool ok = value != NULL;
+        if (ok && strcmp(opt, "-c") == 0)
+            ok = parse_cpus(value, &opts);
+        else if (ok && strcmp(opt, "-n") == 0)
+        {
+            char *end;
+            long v = strtol(value, &end, 10);
+            ok = end != value && *end == '\0' && v >= -20 && v <= 19;
+            opts.has_nice = true;
+            opts.nice = (int)v;
+        }
+        else if (ok && strcmp(opt, "-i") == 0)
+            ok = parse_ioprio(value, &opts);
+        else if (ok && strcmp(opt, "-l") == 0)
+            ok = parse_limit(value, &opts);
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            if (value)
+                printf("launch: bad value for %s: %s\n", opt, value);
+            launch_usage();
+            last_exit_status = 2;
+            return;
+        }
+        any_option = true;
+    }
+
+    // "launch -s ..." / "launch -b ...": change the defaults
+    if (target)
+    {
+        if (command)
+        {
+            launch_usage();
+            last_exit_status = 2;
+            return;
+        }
+        if (reset)
+            memset(target, 0, sizeof(*target));
+        merge_attrs(target, &opts);
+        return;
+    }
+
+    if (!command)
+    {
+        if (any_option || reset)
+        {
+            launch_usage();
+            last_exit_status = 2;
+            return;
+        }
+        print_attrs("session", &session_attrs);
+        print_attrs("background", &background_attrs);
+        return;
+    }
+
+    // one-shot prefix; nested "launch" prefixes stack
+    launch_attrs_t saved = prefix_attrs;
+    merge_attrs(&prefix_attrs, &opts);
+    run_command(command);
+    prefix_attrs = saved;
+}
@@ -11,6 +11,14 @@
 // parsing/execution function without creating a circular dependency
 void (*run_command_func)(char *);
 
+// cleared in forked copies of the shell, which leave the history file to the shell
+static bool history_enabled = true;
+
+void log_set_enabled(bool enabled)
+{
+    history_enabled = enabled;
+}
+
 // a small helper function I wrote to remove trailing whitespace from a string
 void trim_whitespace(char *str)
 {
@@ -26,6 +34,12 @@ void trim_whitespace(char *str)
 
 void add_to_log(char *cmd, const char *home_dir)
 {
+    if (!history_enabled)
+        return;
+    // history entries are fixed-size lines; a longer command would come back cut off
+    if (strlen(cmd) >= MAX_CMD_LEN)
+        return;
+
     char history[MAX_HISTORY][MAX_CMD_LEN];
     int count = 0;
 
@@ -102,7 +116,7 @@ void add_to_log(char *cmd, const char *home_dir)
 }
 
 // this takes care of displaying, purging or executing a history command
-void execute_log(char **args, const char *home_dir, void (*func)(char *))
+void execute_log(char **args, const char *home_dir, void (*func)(char *), FILE *out)
 {
     run_command_func = func;
 
@@ -140,7 +154,7 @@ void execute_log(char **args, const char *home_dir, void (*func)(char *))
     {
         if (!args[2])
         {
-            printf("Usage: log execute <index>\n");
+            fprintf(out, "Usage: log execute <index>\n");
             return;
         }
         int index = atoi(args[2]);
@@ -149,7 +163,7 @@ void execute_log(char **args, const char *home_dir, void (*func)(char *))
         int array_index = count - index;
         if (array_index < 0 || array_index >= count)
         {
-            printf("Invalid index.\n");
+            fprintf(out, "Invalid index.\n");
             return;
         }
         run_command_func(history[array_index]);
@@ -160,14 +174,14 @@ void execute_log(char **args, const char *home_dir, void (*func)(char *))
     // handle "log" with no arguments
     for (int i = 0; i < count; i++)
     {
-        printf("%s", history[i]);
+        fprintf(out, "%s", history[i]);
         if (i < count - 1)
         {
-            printf("\n");
+            fprintf(out, "\n");
         }
     }
     if (count > 0)
     {
-        printf("\n"); // final newline
+        fprintf(out, "\n"); // final newline
     }
 }
\ No newline at end of file
@@ -1,14 +1,16 @@
 #include "prompt.h"
 #include "parser.h"
+#include "parsecache.h"
 #include "hop.h"
 #include "reveal.h"
 #include "log.h"
 #include "exec.h"
 #include "pipe.h"
-#include "config.h"
 #include "jobs.h"
 #include "signals.h"
 #include "globals.h"
+#include "pathcache.h"
+#include "builtins.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -17,64 +19,234 @@
 #include <fcntl.h>
 #include <ctype.h>
 #include <limits.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
-#define MAX_ARGS 64
-#define MAX_CMDS 10
-
-// a small global variable to store the path for the home directory
-char home_dir[1024];
+// false when running a script or -c string
+static bool interactive = true;
 
 // a helper function to encapsulate the parsing and execution logic
 void run_command(char *cmd);
 
-static void strip_surrounding_quotes(char *s)
+// where here-document bodies come from: the rest of a script buffer, or stdin
+typedef struct {
+    const char *buf;    // NULL: stdin
+    size_t len;
+    size_t *pos;
+} line_source_t;
+
+// the next line without its newline, in a buffer that grows as needed
+static bool next_body_line(line_source_t *src, char **line, size_t *cap)
 {
-    if (!s)
-        return;
-    size_t n = strlen(s);
-    if (n >= 2)
+    if (!src->buf)
     {
-        if ((s[0] == '"' && s[n - 1] == '"') ||
-            (s[0] == '\'' && s[n - 1] == '\''))
+        if (interactive)
         {
-            // remove the outer quotes in-place
-            memmove(s, s + 1, n - 2);
-            s[n - 2] = '\0';
+            printf("> ");
+            fflush(stdout);
         }
+        ssize_t n = getline(line, cap, stdin);
+        if (n < 0)
+            return false;
+        if (n > 0 && (*line)[n - 1] == '\n')
+            (*line)[n - 1] = '\0';
+        return true;
     }
+
+    if (*src->pos >= src->len)
+        return false;
+    const char *start = src->buf + *src->pos;
+    const char *nl = memchr(start, '\n', src->len - *src->pos);
+    size_t n = nl ? (size_t)(nl - start) : src->len - *src->pos;
+    *src->pos += n + (nl ? 1 : 0);
+    if (n + 1 > *cap)
+    {
+        char *grown = realloc(*line, n + 1);
+        if (!grown)
+            return false;
+        *line = grown;
+        *cap = n + 1;
+    }
+    memcpy(*line, start, n);
+    (*line)[n] = '\0';
+    return true;
 }
 
-// parse_arguments: reentrant tokenizer using strtok_r
-void parse_arguments(char *input, char **args)
+// a line with "<<word" in it: read each body, up to its delimiter, from the
+// lines that follow and queue it for parse_input. Bodies have no length limit
+static void read_heredocs(const char *line, line_source_t *src)
 {
-    char *token;
-    char *saveptr;
-    int i = 0;
+    heredoc_spec_t *specs;
+    int count = heredoc_find(line, &specs);
+    char *text = NULL;
+    size_t text_cap = 0;
 
-    input[strcspn(input, "\n")] = '\0';
+    for (int i = 0; i < count; i++)
+    {
+        char *body = NULL;
+        size_t len = 0, cap = 0;
+        bool closed = false;
+        while (next_body_line(src, &text, &text_cap))
+        {
+            char *t = text;
+            if (specs[i].strip_tabs)
+                while (*t == '\t')
+                    t++;
+            if (strcmp(t, specs[i].delim) == 0)
+            {
+                closed = true;
+                break;
+            }
 
-    token = strtok_r(input, " \t", &saveptr);
-    while (token != NULL && i < MAX_ARGS - 1)
+            size_t n = strlen(t);
+            if (len + n + 2 > cap)
+            {
+                size_t grown_cap = cap ? cap : 256;
+                while (len + n + 2 > grown_cap)
+                    grown_cap *= 2;
+                char *grown = realloc(body, grown_cap);
+                if (!grown)
+                    break;
+                body = grown;
+                cap = grown_cap;
+            }
+            memcpy(body + len, t, n);
+            len += n;
+            body[len++] = '\n';
+            body[len] = '\0';
+        }
+        if (!closed)
+            fprintf(stderr, "warning: here-document delimited by end-of-file (wanted '%s')\n", specs[i].delim);
+        heredoc_push(body ? body : strdup(""));
+    }
+    free(text);
+    heredoc_free_specs(specs, count);
+}
+
+// run every line of a script held in memory. The last line is exec'd in place
+// of forking when it is a plain external command, since the shell would only
+// wait for it and exit
+static void run_script_buffer(const char *buf, size_t len)
+{
+    // grows to the longest line; nothing is cut off
+    char *line = NULL;
+    size_t line_cap = 0;
+    size_t pos = 0;
+
+    while (pos < len)
     {
-        strip_surrounding_quotes(token);
-        args[i++] = token;
-        token = strtok_r(NULL, " \t", &saveptr);
+        const char *start = buf + pos;
+        const char *nl = memchr(start, '\n', len - pos);
+        size_t line_len = nl ? (size_t)(nl - start) : len - pos;
+        pos += line_len + (nl ? 1 : 0);
+
+        if (line_len + 1 > line_cap)
+        {
+            char *grown = realloc(line, line_len + 1);
+            if (!grown)
+            {
+                perror("malloc");
+                break;
+            }
+            line = grown;
+            line_cap = line_len + 1;
+        }
+        memcpy(line, start, line_len);
+        line[line_len] = '\0';
+
+        // skip blank lines and comments
+        char *p = line;
+        while (*p && isspace((unsigned char)*p))
+            p++;
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        if (strstr(p, "<<"))
+        {
+            line_source_t src = {buf, len, &pos};
+            read_heredocs(p, &src);
+        }
+
+        // is this the last line that does anything?
+        size_t rest = pos;
+        while (rest < len && isspace((unsigned char)buf[rest]))
+            rest++;
+        exec_in_place = (rest == len) && can_exec_in_place(p);
+
+        process_signal_events();
+        run_command(line);
+        heredoc_clear();
+        exec_in_place = false;
     }
-    args[i] = NULL;
+    free(line);
 }
 
-int main(void)
+// map the script (or read it in large blocks if it can't be mapped, e.g. a pipe)
+static int run_script_file(const char *path)
 {
-    char input_buffer[INPUT_SIZE];
-    if (getcwd(home_dir, sizeof(home_dir)) == NULL)
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
     {
-        perror("getcwd");
-        return 1;
+        perror(path);
+        return 127;
     }
 
-    prev_dir[0] = '\0';
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        if (st.st_size == 0)
+        {
+            close(fd);
+            return 0;
+        }
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            close(fd);
+            posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+            run_script_buffer(map, st.st_size);
+            munmap(map, st.st_size);
+            return last_exit_status;
+        }
+    }
 
-    install_signal_handlers();
+    size_t cap = 1 << 16, len = 0;
+    char *buf = malloc(cap);
+    ssize_t n;
+    while (buf)
+    {
+        if (len == cap)
+        {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown)
+                break;
+            buf = grown;
+            cap *= 2;
+        }
+        n = read(fd, buf + len, cap - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += n;
+    }
+    close(fd);
+    if (!buf)
+    {
+        perror("malloc");
+        return 1;
+    }
+    run_script_buffer(buf, len);
+    free(buf);
+    return last_exit_status;
+}
+
+static void interactive_loop(void)
+{
+    // getline grows it to whatever is typed or pasted
+    char *input_buffer = NULL;
+    size_t input_cap = 0;
 
     while (1)
     {
@@ -87,517 +259,276 @@ int main(void)
         }
 
         // 3) Read user input
-        if (fgets(input_buffer, sizeof(input_buffer), stdin) == NULL)
+        if (getline(&input_buffer, &input_cap, stdin) < 0)
         {
             // EOF (Ctrl-D)
-            for (int i = 0; i < job_count; i++)
-            {
-                kill(job_list[i].pid, SIGKILL);
-            }
+            jobs_kill_all();
             printf("logout\n");
             exit(0);
         }
 
+        if (strstr(input_buffer, "<<"))
+        {
+            line_source_t src = {NULL, 0, NULL};
+            read_heredocs(input_buffer, &src);
+        }
+
         // 5) Execute the command
         run_command(input_buffer);
+        heredoc_clear();
     }
-
-    return 0;
 }
 
-// helper: run a builtin with temporary redirections (foreground only)
-static void run_builtin_with_redirs(
-    void (*builtin_func)(char **, const char *),                    // hop
-    void (*builtin_func2)(char **, const char *),                   // reveal
-    void (*builtin_func3)(char **, const char *, void (*)(char *)), // log
-    void (*simple_builtin)(char **),                                // echo
-    char **args,
-    char *in_file, char *out_file, bool append,
-    const char *home_dir, char *prev_dir)
+int main(int argc, char **argv)
 {
-    int saved_stdin = dup(STDIN_FILENO);
-    int saved_stdout = dup(STDOUT_FILENO);
-    int fd;
-
-    if (in_file)
+    if (getcwd(home_dir, sizeof(home_dir)) == NULL)
     {
-        fd = open(in_file, O_RDONLY);
-        if (fd < 0)
-        {
-            fprintf(stderr, "No such file or directory\n");
-            goto restore;
-        }
-        dup2(fd, STDIN_FILENO);
-        close(fd);
+        perror("getcwd");
+        return 1;
     }
 
-    if (out_file)
-    {
-        int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
-        fd = open(out_file, flags, 0644);
-        if (fd < 0)
-        {
-            fprintf(stderr, "No such file or directory\n");
-            goto restore;
-        }
-        dup2(fd, STDOUT_FILENO);
-        close(fd);
-    }
+    prev_dir[0] = '\0';
+
+    // a typo in the builtin table would leave a builtin unreachable
+    if (!builtin_table_ok())
+        return 1;
 
-    if (builtin_func)
-        builtin_func(args, home_dir);
-    else if (builtin_func2)
-        builtin_func2(args, home_dir);
-    else if (builtin_func3)
-        builtin_func3(args, home_dir, run_command);
-    else if (simple_builtin)
-        simple_builtin(args);
-
-restore:
-    if (saved_stdin >= 0)
+    install_signal_handlers();
+    builtins_set_runner(run_command);
+    jobs_set_launcher(run_command);
+
+    // shell.out -c 'commands' / shell.out script.sh: no prompt, no history
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0)
     {
-        dup2(saved_stdin, STDIN_FILENO);
-        close(saved_stdin);
+        interactive = false;
+        run_script_buffer(argv[2], strlen(argv[2]));
+        wait_for_batch_jobs();
+        fflush(stdout);
+        return last_exit_status;
     }
-    if (saved_stdout >= 0)
+    if (argc >= 2)
     {
-        dup2(saved_stdout, STDOUT_FILENO);
-        close(saved_stdout);
+        if (argv[1][0] == '-' && argv[1][1] != '\0')
+        {
+            fprintf(stderr, "Usage: %s [-c commands | script]\n", argv[0]);
+            return 2;
+        }
+        interactive = false;
+        int status = run_script_file(argv[1]);
+        wait_for_batch_jobs();
+        fflush(stdout);
+        return status;
     }
-}
 
-// builtin echo helper
-static void builtin_echo(char **args)
-{
-    for (int i = 1; args[i] != NULL; i++)
-    {
-        printf("%s", args[i]);
-        if (args[i + 1] != NULL)
-            printf(" ");
-    }
-    printf("\n");
+    interactive_loop();
+    return 0;
 }
 
-// the main command driver
-void run_command(char *cmd)
+// builtins, the shell-state commands and external programs; text is the
+// pipeline as typed, for history and the job table
+static void run_simple_command(command_t *parsed, const char *text)
 {
-    bool background = false;
-
-    // at the beginning of run_command(), before any other processing:
-    // handle "command & rest" pattern
-    char *amp_space = strstr(cmd, " & ");
-    if (amp_space && amp_space[3] != '\0')
-    {                      // make sure there's something after " & "
-        *amp_space = '\0'; // split the string
-        // char *bg_part = cmd;
-        char *fg_part = amp_space + 3;
-
-        // execute background part
-        // run_command(strcat(bg_part, " &")); // add & back for background processing
-        if ((amp_space = strstr(cmd, " & ")) != NULL && *(amp_space + 3) != '\0')
-        {
-            *amp_space = '\0';
-            char bg_cmd[1024];
-            snprintf(bg_cmd, sizeof(bg_cmd), "%s &", cmd);
-
-            run_command(bg_cmd);
-            run_command(amp_space + 3);
-            return;
-        }
-
-        // execute foreground part
-        run_command(fg_part);
+    if (parsed->argc == 0)
         return;
-    }
-    char job_cmd[1024];
-    strncpy(job_cmd, cmd, sizeof(job_cmd) - 1);
-    job_cmd[sizeof(job_cmd) - 1] = '\0';
-
-    // size_t L = strlen(cmd);
-    // while (L > 0 && isspace((unsigned char)cmd[L - 1]))
-    //     L--;
-    // if (L > 0 && cmd[L - 1] == '&')
-    // {
-    //     background = true;
-    //     cmd[L - 1] = '\0';
-    //     job_cmd[L - 1] = '\0';
-    //     size_t K = strlen(job_cmd);
-    //     while (K > 0 && isspace((unsigned char)job_cmd[K - 1]))
-    //         job_cmd[--K] = '\0';
-    // }
-
-    char check_buf[1024];
-    strncpy(check_buf, cmd, sizeof(check_buf) - 1);
-    check_buf[sizeof(check_buf) - 1] = '\0';
-    if (!is_valid_syntax(check_buf))
-    {
-        printf("Invalid Syntax!\n");
-        return;
-    }
 
-    // handle sequential commands separated by ';'
-    if (strchr(cmd, ';') != NULL)
-    {
-        char temp_seq_cmd[1024];
-        strncpy(temp_seq_cmd, cmd, sizeof(temp_seq_cmd) - 1);
-        temp_seq_cmd[sizeof(temp_seq_cmd) - 1] = '\0';
+    bool background = parsed->background;
 
-        char *saveptr_seq;
-        char *seq_cmd = strtok_r(temp_seq_cmd, ";", &saveptr_seq);
+    // add to log (use original command, not parsed args); scripts keep no history
+    if (interactive && strcmp(parsed->argv[0], "log") != 0)
+        add_to_log((char *)text, home_dir);
 
-        while (seq_cmd != NULL)
-        {
-            // trim leading/trailing spaces
-            while (*seq_cmd && isspace((unsigned char)*seq_cmd))
-                seq_cmd++;
-            size_t len = strlen(seq_cmd);
-            while (len > 0 && isspace((unsigned char)seq_cmd[len - 1]))
-                seq_cmd[--len] = '\0';
-
-            if (strlen(seq_cmd) > 0)
-            {
-                // recursively call run_command for each sequential command
-                run_command(seq_cmd);
-            }
+    // builtins succeed unless they say otherwise; external commands set their own status
+    last_exit_status = 0;
 
-            seq_cmd = strtok_r(NULL, ";", &saveptr_seq);
+    // one table lookup; whatever isn't in it goes straight to exec
+    const builtin_t *builtin = builtin_for(parsed, false);
+    if (builtin)
+    {
+        // exec_in_place is for this line's own command: not the builtin, and
+        // not whatever it runs in turn (log execute replaying a whole entry)
+        exec_in_place = false;
+        // validate redirections first; the builtin gets the fds we opened
+        redir_t redir;
+        if (validate_redirections(parsed, &redir) < 0)
+        {
+            last_exit_status = 1;
+            return;
+        }
+        if (!background || builtin->kind == BUILTIN_SHELL)
+        {
+            run_builtin_foreground(builtin->run, parsed->argv, &redir);
+            wait_redirections(&redir);
+        }
+        else
+        {
+            run_builtin_background(builtin, parsed->argv, &redir, (char *)text);
+            close_redirections(&redir);
         }
         return;
     }
 
-    // pipeline handling
-    if (strchr(cmd, '|') != NULL)
-    {
-        command_t *commands[MAX_CMDS];
-        int cmd_count = 0;
+    // not builtin: external
+    execute_command(parsed);
+}
 
-        char temp_pipe_cmd[1024];
-        strncpy(temp_pipe_cmd, cmd, sizeof(temp_pipe_cmd) - 1);
-        temp_pipe_cmd[sizeof(temp_pipe_cmd) - 1] = '\0';
+// prefix keywords (time, launch, ...: BUILTIN_PREFIX in the builtin table) take
+// the rest of the pipeline's text and hand part of it back to run; the handlers
+// only split words off the front, so what comes back maps onto the same parsed
+// pipeline minus that many leading words
+typedef struct {
+    pipeline_t *pipeline;
+    char *text;         // the handler's copy of the text after the keyword
+    int skip;           // words of the first command already used up
+} prefix_run_t;
 
-        char *saveptr_pipe;
-        char *cmd_str = strtok_r(temp_pipe_cmd, "|", &saveptr_pipe);
-        while (cmd_str != NULL && cmd_count < MAX_CMDS)
-        {
-            // trim leading/trailing spaces
-            while (*cmd_str && isspace((unsigned char)*cmd_str))
-                cmd_str++;
-            size_t len = strlen(cmd_str);
-            while (len > 0 && isspace((unsigned char)cmd_str[len - 1]))
-                cmd_str[--len] = '\0';
-
-            command_t *c = parse_input(cmd_str);
-            if (c)
-                commands[cmd_count++] = c;
-
-            cmd_str = strtok_r(NULL, "|", &saveptr_pipe);
-        }
-        commands[cmd_count] = NULL;
+static prefix_run_t prefix_run;
 
-        execute_pipeline(commands, background);
+static void run_pipeline(pipeline_t *p, int skip);
 
-        // cleanup
-        for (int i = 0; i < cmd_count; ++i)
-            free_command(commands[i]);
+static bool is_word_char(char c)
+{
+    return c && !isspace((unsigned char)c) && !strchr("|&<>;", c);
+}
 
-        return;
+// text past the first n words
+static const char *skip_words(const char *text, int n)
+{
+    const char *p = text;
+    for (int i = 0; i < n; i++)
+    {
+        while (*p && !is_word_char(*p))
+            p++;
+        while (is_word_char(*p))
+            p++;
     }
+    return p;
+}
 
-    // single command
-    command_t *parsed = parse_input(cmd);
-    if (!parsed || parsed->argc == 0)
+static void run_prefix_rest(char *rest)
+{
+    char *text = prefix_run.text;
+    size_t len = strlen(text);
+    // a handler that built a string of its own: parse that instead
+    if (rest < text || rest > text + len)
     {
-        if (parsed)
-            free_command(parsed);
+        run_command(rest);
         return;
     }
 
-    background = parsed->background;
+    // handlers may have cut words apart with NULs
+    int words = 0;
+    for (char *p = text; p < rest;)
+    {
+        while (p < rest && !is_word_char(*p))
+            p++;
+        if (p == rest)
+            break;
+        words++;
+        while (p < rest && is_word_char(*p))
+            p++;
+    }
+    run_pipeline(prefix_run.pipeline, prefix_run.skip + words);
+}
 
-    // add to log (use original command, not parsed args)
-    if (strcmp(parsed->argv[0], "log") != 0)
-        add_to_log(job_cmd, home_dir);
+// one pipeline, starting at word skip of its first command (past prefix keywords)
+static void run_pipeline(pipeline_t *p, int skip)
+{
+    command_t *first = p->commands[0];
+    const char *text = skip_words(p->text, skip);
+    while (*text && isspace((unsigned char)*text))
+        text++;
 
-    // builtins: hop, reveal, log, echo
-    if (strcmp(parsed->argv[0], "hop") == 0)
+    if (skip >= first->argc)
     {
-        if (!background)
-        {
-            // validate redirections first
-            if (validate_redirections(parsed) < 0)
-            {
-                free_command(parsed);
-                return;
-            }
-            run_builtin_with_redirs(execute_hop, NULL, NULL, NULL,
-                                    parsed->argv,
-                                    parsed->in_count > 0 ? parsed->in_files[parsed->in_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_files[parsed->out_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_append[parsed->out_count - 1] : false,
-                                    home_dir, prev_dir);
-        }
-        else
-        {
-            // background hop - fork and handle redirections
-            pid_t pid = fork();
-            if (pid == 0)
-            {
-                setpgid(0, 0);
-                if (parsed->in_count > 0)
-                {
-                    int fd = open(parsed->in_files[parsed->in_count - 1], O_RDONLY);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
-                }
-                if (parsed->out_count > 0)
-                {
-                    int flags = O_WRONLY | O_CREAT | (parsed->out_append[parsed->out_count - 1] ? O_APPEND : O_TRUNC);
-                    int fd = open(parsed->out_files[parsed->out_count - 1], flags, 0644);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDOUT_FILENO);
-                    close(fd);
-                }
-                execute_hop(parsed->argv, home_dir);
-                _exit(EXIT_SUCCESS);
-            }
-            else if (pid > 0)
-            {
-                setpgid(pid, pid);
-                jobs_add(pid, job_cmd);
-            }
-        }
-        free_command(parsed);
+        printf("Invalid Syntax!\n");
+        last_exit_status = 2;
         return;
     }
 
-    if (strcmp(parsed->argv[0], "reveal") == 0)
+    const builtin_t *prefix = builtin_find(first->argv[skip]);
+    if (prefix && prefix->kind == BUILTIN_PREFIX)
     {
-        if (!background)
-        {
-            if (validate_redirections(parsed) < 0)
-            {
-                free_command(parsed);
-                return;
-            }
-            run_builtin_with_redirs(NULL, execute_reveal, NULL, NULL,
-                                    parsed->argv,
-                                    parsed->in_count > 0 ? parsed->in_files[parsed->in_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_files[parsed->out_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_append[parsed->out_count - 1] : false,
-                                    home_dir, prev_dir);
-        }
-        else
+        char *rest = strdup(skip_words(text, 1));
+        if (!rest)
         {
-            pid_t pid = fork();
-            if (pid == 0)
-            {
-                setpgid(0, 0);
-                if (parsed->in_count > 0)
-                {
-                    int fd = open(parsed->in_files[parsed->in_count - 1], O_RDONLY);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
-                }
-                if (parsed->out_count > 0)
-                {
-                    int flags = O_WRONLY | O_CREAT | (parsed->out_append[parsed->out_count - 1] ? O_APPEND : O_TRUNC);
-                    int fd = open(parsed->out_files[parsed->out_count - 1], flags, 0644);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDOUT_FILENO);
-                    close(fd);
-                }
-                execute_reveal(parsed->argv, home_dir);
-                _exit(EXIT_SUCCESS);
-            }
-            else if (pid > 0)
-            {
-                setpgid(pid, pid);
-                jobs_add(pid, job_cmd);
-            }
+            perror("malloc");
+            return;
         }
-        free_command(parsed);
+        prefix_run_t saved = prefix_run;
+        prefix_run.pipeline = p;
+        prefix_run.text = rest;
+        prefix_run.skip = skip + 1;
+        prefix->prefix(rest, run_prefix_rest);
+        prefix_run = saved;
+        free(rest);
         return;
     }
 
-    if (strcmp(parsed->argv[0], "log") == 0)
+    // the parsed commands stay untouched: a shallow copy drops the prefix words
+    command_t shifted = *first;
+    shifted.argv += skip;
+    shifted.argc -= skip;
+
+    if (p->count == 1)
     {
-        if (!background)
-        {
-            if (validate_redirections(parsed) < 0)
-            {
-                free_command(parsed);
-                return;
-            }
-            run_builtin_with_redirs(NULL, NULL, execute_log, NULL,
-                                    parsed->argv,
-                                    parsed->in_count > 0 ? parsed->in_files[parsed->in_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_files[parsed->out_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_append[parsed->out_count - 1] : false,
-                                    home_dir, prev_dir);
-        }
-        else
-        {
-            pid_t pid = fork();
-            if (pid == 0)
-            {
-                setpgid(0, 0);
-                if (parsed->in_count > 0)
-                {
-                    int fd = open(parsed->in_files[parsed->in_count - 1], O_RDONLY);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
-                }
-                if (parsed->out_count > 0)
-                {
-                    int flags = O_WRONLY | O_CREAT | (parsed->out_append[parsed->out_count - 1] ? O_APPEND : O_TRUNC);
-                    int fd = open(parsed->out_files[parsed->out_count - 1], flags, 0644);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDOUT_FILENO);
-                    close(fd);
-                }
-                execute_log(parsed->argv, home_dir, run_command);
-                _exit(EXIT_SUCCESS);
-            }
-            else if (pid > 0)
-            {
-                setpgid(pid, pid);
-                jobs_add(pid, job_cmd);
-            }
-        }
-        free_command(parsed);
+        run_simple_command(&shifted, text);
         return;
     }
 
-    if (strcmp(parsed->argv[0], "echo") == 0)
+    command_t **commands = malloc((p->count + 1) * sizeof(command_t *));
+    if (!commands)
     {
-        if (!background)
-        {
-            if (validate_redirections(parsed) < 0)
-            {
-                free_command(parsed);
-                return;
-            }
-            run_builtin_with_redirs(NULL, NULL, NULL, builtin_echo,
-                                    parsed->argv,
-                                    parsed->in_count > 0 ? parsed->in_files[parsed->in_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_files[parsed->out_count - 1] : NULL,
-                                    parsed->out_count > 0 ? parsed->out_append[parsed->out_count - 1] : false,
-                                    home_dir, prev_dir);
-        }
-        else
-        {
-            pid_t pid = fork();
-            if (pid == 0)
-            {
-                setpgid(0, 0);
-                if (parsed->in_count > 0)
-                {
-                    int fd = open(parsed->in_files[parsed->in_count - 1], O_RDONLY);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDIN_FILENO);
-                    close(fd);
-                }
-                if (parsed->out_count > 0)
-                {
-                    int flags = O_WRONLY | O_CREAT | (parsed->out_append[parsed->out_count - 1] ? O_APPEND : O_TRUNC);
-                    int fd = open(parsed->out_files[parsed->out_count - 1], flags, 0644);
-                    if (fd < 0)
-                        _exit(EXIT_FAILURE);
-                    dup2(fd, STDOUT_FILENO);
-                    close(fd);
-                }
-                builtin_echo(parsed->argv);
-                _exit(EXIT_SUCCESS);
-            }
-            else if (pid > 0)
-            {
-                setpgid(pid, pid);
-                jobs_add(pid, job_cmd);
-            }
-        }
-        free_command(parsed);
+        perror("malloc");
         return;
     }
+    memcpy(commands, p->commands, (p->count + 1) * sizeof(command_t *));
+    commands[0] = &shifted;
+    execute_pipeline(commands, p->background);
+    free(commands);
+}
 
-    // Part E Builtins
-    if (strcmp(parsed->argv[0], "logout") == 0)
+// the main command driver: the line is tokenized and parsed once, then the
+// tree is run pipeline by pipeline
+void run_command(char *cmd)
+{
+    // buffers grow with the line, up to what exec could take anyway
+    static size_t arg_max = 0;
+    if (!arg_max)
     {
-        for (int i = 0; i < job_count; i++)
-            kill(job_list[i].pid, SIGKILL);
-        printf("logout\n");
-        exit(0);
+        long limit = sysconf(_SC_ARG_MAX);
+        arg_max = limit > 0 ? (size_t)limit : 128 * 1024;
     }
-
-    if (strcmp(parsed->argv[0], "activities") == 0)
+    if (strlen(cmd) > arg_max)
     {
-        jobs_print_activities();
-        free_command(parsed);
+        fprintf(stderr, "Argument list too long\n");
+        last_exit_status = 126;
         return;
     }
 
-    if (strcmp(parsed->argv[0], "ping") == 0)
+    // a line seen lately comes back already parsed; redirections are still
+    // opened (and checked) when each command runs
+    command_line_t *line = parse_cached(cmd);
+    if (!line)
     {
-        if (!parsed->argv[1] || !parsed->argv[2])
-        {
-            printf("Usage: ping <pid> <signal_number>\n");
-        }
-        else
-        {
-            pid_t pid = (pid_t)atoi(parsed->argv[1]);
-            int sig = atoi(parsed->argv[2]) % 32;
-            jobs_ping(pid, sig);
-        }
-        free_command(parsed);
+        printf("Invalid Syntax!\n");
+        last_exit_status = 2;
         return;
     }
 
-    if (strcmp(parsed->argv[0], "fg") == 0)
+    for (int i = 0; i < line->count; i++)
     {
-        if (job_count == 0)
-        {
-            printf("No such job\n");
-            free_command(parsed);
-            return;
-        }
-        int job_num;
-        if (parsed->argv[1])
-        {
-            job_num = atoi(parsed->argv[1]);
-        }
-        else
-        {
-            job_num = job_list[job_count - 1].job_id;
-        }
-        jobs_fg(job_num);
-        free_command(parsed);
-        return;
-    }
+        pipeline_t *p = &line->pipelines[i];
+        // "a && b": b only if a succeeded
+        if (p->if_success && last_exit_status != 0)
+            continue;
 
-    if (strcmp(parsed->argv[0], "bg") == 0)
-    {
-        if (!parsed->argv[1])
-        {
-            printf("Usage: bg <job_number>\n");
-        }
-        else
+        // over the background limit: park the pipeline until a job finishes
+        if (p->background && jobs_should_queue())
         {
-            jobs_bg(atoi(parsed->argv[1]));
+            jobs_queue(p->text, p->heredocs, p->heredoc_count);
+            continue;
         }
-        free_command(parsed);
-        return;
+        run_pipeline(p, 0);
     }
-
-    // not builtin: external
-    execute_command(parsed);
-    free_command(parsed);
-}
\ No newline at end of file
+    parse_cache_release(line);
+}
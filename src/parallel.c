@@ -0,0 +1,333 @@
+#include "parallel.h"
+#include "spawner.h"
+#include "jobs.h"
+#include "signals.h"
+#include "exec.h"
+#include "timing.h"
+#include "launch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+typedef struct {
+    pid_t pid;          // 0 = free slot
+    int seq;            // 1-based task number
+    double started;
+    char *label;        // the command line, for reports and activities
+} parallel_slot_t;
+
+// the input lines a task list is built from
+typedef struct {
+    char **items;
+    int count;
+    int capacity;
+} input_list_t;
+
+static bool input_push(input_list_t *list, char *item)
+{
+    if (list->count == list->capacity)
+    {
+        int cap = list->capacity ? list->capacity * 2 : 64;
+        char **grown = realloc(list->items, cap * sizeof(char *));
+        if (!grown)
+            return false;
+        list->items = grown;
+        list->capacity = cap;
+    }
+    list->items[list->count++] = item;
+    return true;
+}
+
+// read stdin straight from fd 0 so "< file" redirections and pipes both work
+static void read_inputs(input_list_t *list)
+{
+    char buf[65536];
+    char *partial = NULL;
+    size_t partial_len = 0;
+    ssize_t n;
+
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        char *grown = realloc(partial, partial_len + n + 1);
+        if (!grown)
+            break;
+        partial = grown;
+        memcpy(partial + partial_len, buf, n);
+        partial_len += n;
+
+        // hand out every complete line, keep the tail for the next read
+        size_t start = 0;
+        for (size_t i = 0; i < partial_len; i++)
+        {
+            if (partial[i] != '\n')
+                continue;
+            partial[i] = '\0';
+            if (i > start)
+                input_push(list, strdup(partial + start));
+            start = i + 1;
+        }
+        memmove(partial, partial + start, partial_len - start);
+        partial_len -= start;
+    }
+
+    if (partial_len > 0)
+    {
+        partial[partial_len] = '\0';
+        input_push(list, strdup(partial));
+    }
+    free(partial);
+}
+
+// replace every "{}" in word with input
+static char *substitute(const char *word, const char *input)
+{
+    size_t in_len = strlen(input);
+    size_t out_len = 0;
+    for (const char *p = word; *p;)
+    {
+        if (p[0] == '{' && p[1] == '}')
+        {
+            out_len += in_len;
+            p += 2;
+        }
+        else
+        {
+            out_len++;
+            p++;
+        }
+    }
+
+    char *out = malloc(out_len + 1);
+    if (!out)
+        return NULL;
+    char *o = out;
+    for (const char *p = word; *p;)
+    {
+        if (p[0] == '{' && p[1] == '}')
+        {
+            memcpy(o, input, in_len);
+            o += in_len;
+            p += 2;
+        }
+        else
+        {
+            *o++ = *p++;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
+// argv for one task; without a {} anywhere the input becomes the last argument
+static char **build_argv(char **tmpl, int tmpl_count, bool has_placeholder, const char *input)
+{
+    char **argv = calloc(tmpl_count + 2, sizeof(char *));
+    if (!argv)
+        return NULL;
+    int n = 0;
+    for (int i = 0; i < tmpl_count; i++)
+        argv[n++] = substitute(tmpl[i], input);
+    if (!has_placeholder)
+        argv[n++] = strdup(input);
+    argv[n] = NULL;
+    return argv;
+}
+
+static void free_argv(char **argv)
+{
+    for (int i = 0; argv[i]; i++)
+        free(argv[i]);
+    free(argv);
+}
+
+static char *join_argv(char **argv)
+{
+    size_t len = 1;
+    for (int i = 0; argv[i]; i++)
+        len += strlen(argv[i]) + 1;
+    char *label = malloc(len);
+    if (!label)
+        return NULL;
+    label[0] = '\0';
+    for (int i = 0; argv[i]; i++)
+    {
+        if (i > 0)
+            strcat(label, " ");
+        strcat(label, argv[i]);
+    }
+    return label;
+}
+
+static void print_usage(FILE *out)
+{
+    fprintf(out, "Usage: parallel [-j N] command [args with {}] [::: inputs...]\n");
+}
+
+void execute_parallel(char **args, FILE *out)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_jobs = cpus > 0 ? (int)cpus : 1;
+
+    int i = 1;
+    if (args[i] && strncmp(args[i], "-j", 2) == 0)
+    {
+        const char *value = args[i][2] ? args[i] + 2 : args[i + 1];
+        if (!value || atoi(value) <= 0)
+        {
+            print_usage(out);
+            last_exit_status = 2;
+            return;
+        }
+        max_jobs = atoi(value);
+        i += args[i][2] ? 1 : 2;
+    }
+
+    char **tmpl = &args[i];
+    int tmpl_count = 0;
+    bool has_placeholder = false;
+    while (tmpl[tmpl_count] && strcmp(tmpl[tmpl_count], ":::") != 0)
+    {
+        if (strstr(tmpl[tmpl_count], "{}"))
+            has_placeholder = true;
+        tmpl_count++;
+    }
+    if (tmpl_count == 0)
+    {
+        print_usage(out);
+        last_exit_status = 2;
+        return;
+    }
+
+    input_list_t inputs = {0};
+    if (tmpl[tmpl_count])
+    {
+        for (char **a = &tmpl[tmpl_count + 1]; *a; a++)
+            input_push(&inputs, strdup(*a));
+    }
+    else
+    {
+        read_inputs(&inputs);
+    }
+
+    parallel_slot_t *slots = calloc(max_jobs, sizeof(parallel_slot_t));
+    if (!slots)
+    {
+        perror("parallel");
+        for (int k = 0; k < inputs.count; k++)
+            free(inputs.items[k]);
+        free(inputs.items);
+        return;
+    }
+
+    double begin = timing_now();
+    int next = 0, running = 0, failed = 0;
+    bool stopping = false;
+    take_interrupt();
+
+    while ((next < inputs.count && !stopping) || running > 0)
+    {
+        // top up to max_jobs children
+        while (running < max_jobs && next < inputs.count && !stopping)
+        {
+            int seq = ++next;
+            char **argv = build_argv(tmpl, tmpl_count, has_placeholder, inputs.items[seq - 1]);
+            if (!argv)
+            {
+                failed++;
+                continue;
+            }
+
+            spawn_request_t req;
+            spawn_request_init(&req, argv);
+            req.null_stdin = true;
+            req.attrs = launch_attrs_for(false);
+            char *label = join_argv(argv);
+            pid_t pid = spawn_process(&req);
+            free_argv(argv);
+
+            if (pid < 0)
+            {
+                fprintf(out, "[%d] exit 127  0.000s  %s\n", seq, label ? label : "?");
+                failed++;
+                free(label);
+                continue;
+            }
+
+            int s = 0;
+            while (slots[s].pid != 0)
+                s++;
+            slots[s].pid = pid;
+            slots[s].seq = seq;
+            slots[s].started = timing_now();
+            slots[s].label = label;
+            jobs_add(pid, label ? label : "parallel");
+            running++;
+        }
+
+        if (running == 0)
+            break;
+
+        // reap whichever child finishes next, or wake up for Ctrl-C
+        int status;
+        struct rusage ru;
+        pid_t pid = wait_child_or_interrupt(&status, &ru);
+        if (pid < 0)
+            break;
+
+        // Ctrl-C: start nothing new and stop what is still running
+        if (take_interrupt() && !stopping)
+        {
+            stopping = true;
+            for (int k = 0; k < max_jobs; k++)
+                if (slots[k].pid > 0)
+                    kill(-slots[k].pid, SIGTERM);
+        }
+        if (pid == 0)
+            continue;
+
+        int s = 0;
+        while (s < max_jobs && slots[s].pid != pid)
+            s++;
+        if (s == max_jobs)
+        {
+            // somebody else's child: let the job table report it
+            handle_child_status(pid, status);
+            continue;
+        }
+
+        int code = exit_code_from_status(status);
+        if (code != 0)
+            failed++;
+        fprintf(out, "[%d] exit %d  %.3fs  %s\n", slots[s].seq, code,
+                timing_now() - slots[s].started, slots[s].label ? slots[s].label : "?");
+        fflush(out);
+
+        job_t *job = jobs_find_by_pid(pid);
+        if (job)
+            jobs_remove_by_index(job - job_list);
+        free(slots[s].label);
+        slots[s].pid = 0;
+        slots[s].label = NULL;
+        running--;
+    }
+
+    fprintf(out, "parallel: %d tasks, %d failed, %.3fs\n", next, failed, timing_now() - begin);
+    last_exit_status = failed > 255 ? 255 : failed;
+
+    for (int k = 0; k < inputs.count; k++)
+        free(inputs.items[k]);
+    free(inputs.items);
+    free(slots);
+}
@@ -0,0 +1,143 @@
+#include "parsecache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+// a few dozen lines cover a loop body, a watch command or the history being
+// replayed; longer lines are rare and would pin big arenas, so they always parse
+#define PARSE_CACHE_SIZE 32
+#define PARSE_CACHE_MAX_LINE 1024
+// a line is only kept the second time it turns up among the last few misses,
+// so one-off commands don't push out the ones that repeat
+#define PARSE_CACHE_SEEN 64
+
+// one remembered line; users counts runs still walking its tree (a line can
+// run another one, through "log execute" or a prefix), so it is never evicted
+// from under them
+typedef struct {
+    unsigned long long hash;
+    char *key;
+    command_line_t *line;
+    unsigned long last_used;
+    int users;
+} cache_entry_t;
+
+static cache_entry_t entries[PARSE_CACHE_SIZE];
+static unsigned long use_clock = 0;
+
+static unsigned long long seen[PARSE_CACHE_SEEN];
+static int seen_next = 0;
+
+// the key is the line without surrounding whitespace (and the newline);
+// the spacing inside stays, since it shows up in history and the jobs list
+static unsigned long long hash_key(const char *s, size_t len)
+{
+    unsigned long long h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// true if the line missed recently; otherwise remember it for next time
+static bool seen_before(unsigned long long hash)
+{
+    for (int i = 0; i < PARSE_CACHE_SEEN; i++)
+    {
+        if (seen[i] == hash)
+            return true;
+    }
+    seen[seen_next] = hash;
+    seen_next = (seen_next + 1) % PARSE_CACHE_SEEN;
+    return false;
+}
+
+static void drop_entry(cache_entry_t *e)
+{
+    free_command_line(e->line);
+    free(e->key);
+    memset(e, 0, sizeof(*e));
+}
+
+void parse_cache_clear(void)
+{
+    for (int i = 0; i < PARSE_CACHE_SIZE; i++)
+    {
+        if (entries[i].line && entries[i].users == 0)
+            drop_entry(&entries[i]);
+    }
+    memset(seen, 0, sizeof(seen));
+}
+
+// an empty slot, or the least recently used one nobody is running
+static cache_entry_t *free_slot(void)
+{
+    cache_entry_t *victim = NULL;
+    for (int i = 0; i < PARSE_CACHE_SIZE; i++)
+    {
+        cache_entry_t *e = &entries[i];
+        if (!e->line)
+            return e;
+        if (e->users == 0 && (!victim || e->last_used < victim->last_used))
+            victim = e;
+    }
+    if (victim)
+        drop_entry(victim);
+    return victim;
+}
+
+command_line_t *parse_cached(const char *input)
+{
+    const char *start = input;
+    while (isspace((unsigned char)*start))
+        start++;
+    size_t len = strlen(start);
+    while (len > 0 && isspace((unsigned char)start[len - 1]))
+        len--;
+    if (len > PARSE_CACHE_MAX_LINE)
+        return parse_line(input);
+
+    unsigned long long hash = hash_key(start, len);
+    for (int i = 0; i < PARSE_CACHE_SIZE; i++)
+    {
+        cache_entry_t *e = &entries[i];
+        if (e->line && e->hash == hash && strncmp(e->key, start, len) == 0 && e->key[len] == '\0')
+        {
+            e->last_used = ++use_clock;
+            e->users++;
+            return e->line;
+        }
+    }
+
+    command_line_t *line = parse_line(input);
+    // here-document bodies were taken from the reader for this run only
+    if (!line || line->has_heredoc || !seen_before(hash))
+        return line;
+
+    cache_entry_t *e = free_slot();
+    char *key = e ? strndup(start, len) : NULL;
+    if (!key)
+        return line;
+    e->hash = hash;
+    e->key = key;
+    e->line = line;
+    e->last_used = ++use_clock;
+    e->users = 1;
+    return line;
+}
+
+void parse_cache_release(command_line_t *line)
+{
+    for (int i = 0; i < PARSE_CACHE_SIZE; i++)
+    {
+        if (entries[i].line == line)
+        {
+            entries[i].users--;
+            return;
+        }
+    }
+    free_command_line(line);
+}
@@ -1,4 +1,6 @@
 #include "parser.h"
+#include "arena.h"
+#include "scan.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,339 +15,631 @@ typedef enum
     TOKEN_AMPERSAND,
     TOKEN_DOUBLE_AMP,
     TOKEN_LT,
+    TOKEN_HEREDOC,
+    TOKEN_HERESTRING,
     TOKEN_GT,
     TOKEN_DOUBLE_GT,
     TOKEN_SEMICOLON,
     TOKEN_END
 } token_type;
 
-// global pointer to keep track of the current position in the input string
-static char *pos;
+// a token points into the line; nothing is copied until a command is built
+typedef struct
+{
+    token_type type;
+    const char *start;
+    size_t len;
+} token_t;
 
-// forward declarations
-bool parse_shell_cmd();
-bool parse_cmd_group();
-bool parse_atomic();
-bool parse_name();
-bool parse_output();
-bool parse_input_redirection(void);
-void skip_whitespace();
-token_type peek_next_token();
-void consume_token();
+typedef struct
+{
+    token_t *tokens;
+    int count;
+    int capacity;
+    arena_t *arena;
+} token_list_t;
 
-bool is_valid_syntax(char *input)
+// the parser walks the token array. build is false when only validating;
+// commands come from the arena, or from malloc when it is NULL
+typedef struct
+{
+    const token_t *tok;
+    bool build;
+    arena_t *arena;
+    bool took_heredoc;
+    pipeline_t *pipeline;   // being built: where here-document bodies are noted
+} parse_state_t;
+
+// here-document bodies queued by the reader, oldest first
+static char **heredoc_bodies = NULL;
+static int heredoc_count = 0;
+static int heredoc_next = 0;
+static int heredoc_capacity = 0;
+
+void heredoc_push(char *body)
 {
-    pos = input;
-    bool parsing_successful = parse_shell_cmd();
-    skip_whitespace();
-    if (*pos != '\0')
+    if (heredoc_count == heredoc_capacity)
     {
-        return false;
+        int capacity = heredoc_capacity ? heredoc_capacity * 2 : 4;
+        char **grown = realloc(heredoc_bodies, capacity * sizeof(char *));
+        if (!grown)
+        {
+            free(body);
+            return;
+        }
+        heredoc_bodies = grown;
+        heredoc_capacity = capacity;
     }
-    return parsing_successful;
+    heredoc_bodies[heredoc_count++] = body;
 }
 
-void skip_whitespace()
+// the next queued body, or an empty one if the reader had none (e.g. a line
+// rerun by "log execute"); the caller owns it
+static char *heredoc_pop(void)
 {
-    while (*pos && isspace((unsigned char)*pos))
-    {
-        pos++;
-    }
+    if (heredoc_next < heredoc_count)
+        return heredoc_bodies[heredoc_next++];
+    return strdup("");
 }
 
-token_type peek_next_token()
+void heredoc_clear(void)
 {
-    char *temp_pos = pos;
-    skip_whitespace();
-    token_type type;
-    if (*pos == '\0')
-    {
-        type = TOKEN_END;
-    }
-    else if (*pos == '&' && *(pos + 1) == '&')
-    {
-        type = TOKEN_DOUBLE_AMP;
-    }
-    else if (*pos == '>' && *(pos + 1) == '>')
-    {
-        type = TOKEN_DOUBLE_GT;
-    }
-    else if (*pos == '|')
-    {
-        type = TOKEN_PIPE;
-    }
-    else if (*pos == '<')
-    {
-        type = TOKEN_LT;
-    }
-    else if (*pos == '>')
-    {
-        type = TOKEN_GT;
-    }
-    else if (*pos == '&')
+    while (heredoc_next < heredoc_count)
+        free(heredoc_bodies[heredoc_next++]);
+    heredoc_count = 0;
+    heredoc_next = 0;
+}
+
+void heredoc_save(heredoc_queue_t *saved)
+{
+    *saved = (heredoc_queue_t){heredoc_bodies, heredoc_count, heredoc_next, heredoc_capacity};
+    heredoc_bodies = NULL;
+    heredoc_count = 0;
+    heredoc_next = 0;
+    heredoc_capacity = 0;
+}
+
+void heredoc_restore(const heredoc_queue_t *saved)
+{
+    heredoc_clear();
+    free(heredoc_bodies);
+    heredoc_bodies = saved->bodies;
+    heredoc_count = saved->count;
+    heredoc_next = saved->next;
+    heredoc_capacity = saved->capacity;
+}
+
+void heredoc_free_specs(heredoc_spec_t *specs, int count)
+{
+    for (int i = 0; i < count; i++)
+        free(specs[i].delim);
+    free(specs);
+}
+
+// lines are parsed into arenas that are recycled here, so a steady stream of
+// commands allocates nothing. A line run from inside another (a queued job
+// started by fg, "log execute") simply takes a second arena
+#define ARENA_POOL 4
+static arena_t *arena_pool[ARENA_POOL];
+static int arena_pooled = 0;
+
+static arena_t *arena_acquire(void)
+{
+    if (arena_pooled > 0)
+        return arena_pool[--arena_pooled];
+    arena_t *arena = malloc(sizeof(arena_t));
+    if (arena)
+        arena_init(arena);
+    return arena;
+}
+
+static void arena_release(arena_t *arena)
+{
+    if (arena_pooled < ARENA_POOL)
     {
-        type = TOKEN_AMPERSAND;
+        arena_reset(arena);
+        arena_pool[arena_pooled++] = arena;
+        return;
     }
-    else if (*pos == ';')
+    arena_destroy(arena);
+    free(arena);
+}
+
+static void *parse_alloc(parse_state_t *ps, size_t size)
+{
+    return ps->arena ? arena_alloc(ps->arena, size) : malloc(size);
+}
+
+static char *parse_strndup(parse_state_t *ps, const char *s, size_t n)
+{
+    return ps->arena ? arena_strndup(ps->arena, s, n) : strndup(s, n);
+}
+
+static bool push_token(token_list_t *list, token_type type, const char *start, size_t len)
+{
+    if (list->count == list->capacity)
     {
-        type = TOKEN_SEMICOLON;
+        // the old array stays in the arena until the line is done
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        token_t *grown = arena_alloc(list->arena, capacity * sizeof(token_t));
+        if (!grown)
+            return false;
+        if (list->count)
+            memcpy(grown, list->tokens, list->count * sizeof(token_t));
+        list->tokens = grown;
+        list->capacity = capacity;
     }
-    else
+    list->tokens[list->count++] = (token_t){type, start, len};
+    return true;
+}
+
+// the one pass over the line's bytes; always ends with a TOKEN_END
+static bool tokenize(const char *line, token_list_t *list)
+{
+    const char *p = line;
+    bool here_word = false;
+    while (true)
     {
-        type = TOKEN_NAME;
+        while (*p && isspace((unsigned char)*p))
+            p++;
+
+        token_type type;
+        size_t len = 1;
+        if (*p == '\0')
+            return push_token(list, TOKEN_END, p, 0);
+        else if (p[0] == '&' && p[1] == '&')
+            type = TOKEN_DOUBLE_AMP, len = 2;
+        else if (p[0] == '>' && p[1] == '>')
+            type = TOKEN_DOUBLE_GT, len = 2;
+        else if (strncmp(p, "<<<", 3) == 0)
+            type = TOKEN_HERESTRING, len = 3;
+        else if (p[0] == '<' && p[1] == '<')
+            type = TOKEN_HEREDOC, len = 2;
+        else if (*p == '|')
+            type = TOKEN_PIPE;
+        else if (*p == '<')
+            type = TOKEN_LT;
+        else if (*p == '>')
+            type = TOKEN_GT;
+        else if (*p == '&')
+            type = TOKEN_AMPERSAND;
+        else if (*p == ';')
+            type = TOKEN_SEMICOLON;
+        else if (here_word && (*p == '\'' || *p == '"'))
+        {
+            // a quoted here-string is one word, spaces and all; an unclosed
+            // quote makes the line invalid
+            const char *close = strchr(p + 1, *p);
+            if (!close)
+                return false;
+            type = TOKEN_NAME;
+            len = close + 1 - p;
+        }
+        else
+        {
+            type = TOKEN_NAME;
+            len = scan_word(p);
+        }
+
+        if (!push_token(list, type, p, len))
+            return false;
+        here_word = type == TOKEN_HERESTRING;
+        p += len;
     }
-    pos = temp_pos;
-    return type;
 }
 
-void consume_token()
+static bool is_redirection(token_type type)
 {
-    skip_whitespace();
-    if (*pos == '\0')
-        return;
+    return type == TOKEN_LT || type == TOKEN_HEREDOC || type == TOKEN_HERESTRING ||
+           type == TOKEN_GT || type == TOKEN_DOUBLE_GT;
+}
 
-    if (*pos == '&' && *(pos + 1) == '&')
+// "<<- EOF": the delimiter is the word after the dash
+static bool dash_heredoc(const token_t *t)
+{
+    return t[0].type == TOKEN_HEREDOC && t[1].len == 1 && t[1].start[0] == '-' &&
+           t[2].type == TOKEN_NAME;
+}
+
+// every "<<word" / "<<-word" on the line, in order. The line goes through the
+// tokenizer, so what counts as a here-document is exactly what the parser will
+// take a body for: a "<<" inside a quoted here-string is just text. Quotes
+// around the word are dropped
+int heredoc_find(const char *line, heredoc_spec_t **specs)
+{
+    int count = 0;
+    *specs = NULL;
+    arena_t *arena = arena_acquire();
+    if (!arena)
+        return 0;
+    token_list_t list = {NULL, 0, 0, arena};
+    if (!tokenize(line, &list))
     {
-        pos += 2;
+        arena_release(arena);
+        return 0;
     }
-    else if (*pos == '>' && *(pos + 1) == '>')
+
+    for (const token_t *t = list.tokens; t->type != TOKEN_END; t++)
     {
-        pos += 2;
+        if (t->type != TOKEN_HEREDOC || t[1].type != TOKEN_NAME)
+            continue;
+        bool strip_tabs = dash_heredoc(t);
+        const token_t *word = strip_tabs ? &t[2] : &t[1];
+        const char *p = word->start;
+        size_t n = word->len;
+        // "<<-EOF": the dash came as part of the word
+        if (!strip_tabs && p[0] == '-')
+        {
+            strip_tabs = true;
+            p++;
+            n--;
+        }
+        if (n >= 2 && (p[0] == '\'' || p[0] == '"') && p[n - 1] == p[0])
+        {
+            p++;
+            n -= 2;
+        }
+        if (n == 0)
+            continue;
+
+        heredoc_spec_t *grown = realloc(*specs, (count + 1) * sizeof(heredoc_spec_t));
+        char *delim = strndup(p, n);
+        if (!grown || !delim)
+        {
+            free(delim);
+            if (grown)
+                *specs = grown;
+            break;
+        }
+        *specs = grown;
+        (*specs)[count].delim = delim;
+        (*specs)[count].strip_tabs = strip_tabs;
+        count++;
     }
-    else if (strchr("|&<>;", *pos))
+    arena_release(arena);
+    return count;
+}
+
+// here-string: the word, without surrounding quotes, and a newline
+static char *here_string(parse_state_t *ps, const token_t *t)
+{
+    const char *word = t->start;
+    size_t n = t->len;
+    if (n >= 2 && (word[0] == '\'' || word[0] == '"') && word[n - 1] == word[0])
     {
-        pos++;
+        word++;
+        n -= 2;
     }
-    else
+    char *text = parse_alloc(ps, n + 2);
+    if (text)
     {
-        while (*pos && !isspace((unsigned char)*pos) && !strchr("|&<>;", *pos))
-        {
-            pos++;
-        }
+        memcpy(text, word, n);
+        text[n] = '\n';
+        text[n + 1] = '\0';
     }
+    return text;
 }
 
-bool parse_shell_cmd()
+// a here-document body, taken over from the reader's queue
+static char *here_document(parse_state_t *ps)
 {
-    if (!parse_cmd_group())
-        return false;
+    char *body = heredoc_pop();
+    ps->took_heredoc = true;
+    if (!body || !ps->arena)
+        return body;
+    char *copy = arena_strndup(ps->arena, body, strlen(body));
+    free(body);
+    if (copy && ps->pipeline)
+        ps->pipeline->heredocs[ps->pipeline->heredoc_count++] = copy;
+    return copy;
+}
+
+// words and redirections up to the next operator ("&" too, if allow_amp);
+// cmd is NULL when only validating
+static bool parse_words(parse_state_t *ps, command_t *cmd, bool allow_amp)
+{
+    // the tokens are all there, so count first: every array is allocated
+    // once, at its final size
+    int args = 0, ins = 0, outs = 0;
+    const token_t *t = ps->tok;
     while (true)
     {
-        token_type tok = peek_next_token();
-        if (tok == TOKEN_DOUBLE_AMP || tok == TOKEN_SEMICOLON)
+        if (t->type == TOKEN_NAME)
+            args++, t++;
+        else if (allow_amp && t->type == TOKEN_AMPERSAND)
+            t++;
+        else if (is_redirection(t->type))
         {
-            consume_token();
-            if (!parse_cmd_group())
+            // every redirection takes a word
+            if (t[1].type != TOKEN_NAME)
                 return false;
+            if (t->type == TOKEN_GT || t->type == TOKEN_DOUBLE_GT)
+                outs++;
+            else
+                ins++;
+            t += dash_heredoc(t) ? 3 : 2;
         }
         else
-        {
             break;
-        }
     }
-    if (peek_next_token() == TOKEN_AMPERSAND)
+    const token_t *end = t;
+    if (!cmd)
     {
-        consume_token();
+        ps->tok = end;
+        return true;
     }
-    return true;
-}
 
-bool parse_cmd_group()
-{
-    if (!parse_atomic())
+    cmd->argv = parse_alloc(ps, (args + 1) * sizeof(char *));
+    cmd->in_files = parse_alloc(ps, (ins + 1) * sizeof(char *));
+    cmd->in_here = parse_alloc(ps, (ins + 1) * sizeof(bool));
+    cmd->out_files = parse_alloc(ps, (outs + 1) * sizeof(char *));
+    cmd->out_append = parse_alloc(ps, (outs + 1) * sizeof(bool));
+    if (!cmd->argv || !cmd->in_files || !cmd->in_here || !cmd->out_files || !cmd->out_append)
         return false;
-    while (peek_next_token() == TOKEN_PIPE)
-    {
-        consume_token();
-        token_type t = peek_next_token();
-        if (t == TOKEN_PIPE || t == TOKEN_SEMICOLON || t == TOKEN_END)
-            return false;
-        if (!parse_atomic())
-            return false;
-    }
-    return true;
-}
+    cmd->argv[0] = NULL;
 
-bool parse_atomic()
-{
-    if (!parse_name())
-        return false;
-    while (true)
+    for (t = ps->tok; t < end;)
     {
-        token_type nt = peek_next_token();
-        if (nt == TOKEN_NAME)
+        char *text = NULL;
+        if (t->type == TOKEN_AMPERSAND)
         {
-            if (!parse_name())
-                return false;
+            cmd->background = true;
+            t++;
+            continue;
         }
-        else if (nt == TOKEN_LT)
+        if (t->type == TOKEN_NAME)
         {
-            if (!parse_input_redirection())
+            if (!(text = parse_strndup(ps, t->start, t->len)))
                 return false;
+            cmd->argv[cmd->argc++] = text;
+            cmd->argv[cmd->argc] = NULL;
+            t++;
+            continue;
         }
-        else if (nt == TOKEN_GT || nt == TOKEN_DOUBLE_GT)
+
+        const token_t *word = t + 1;
+        if (t->type == TOKEN_HEREDOC)
+            text = here_document(ps);  // the delimiter only mattered to the reader
+        else if (t->type == TOKEN_HERESTRING)
+            text = here_string(ps, word);
+        else
+            text = parse_strndup(ps, word->start, word->len);
+        if (!text)
+            return false;
+
+        if (t->type == TOKEN_GT || t->type == TOKEN_DOUBLE_GT)
         {
-            if (!parse_output())
-                return false;
+            cmd->out_files[cmd->out_count] = text;
+            cmd->out_append[cmd->out_count++] = t->type == TOKEN_DOUBLE_GT;
         }
         else
         {
-            break;
+            cmd->in_files[cmd->in_count] = text;
+            cmd->in_here[cmd->in_count++] = t->type != TOKEN_LT;
         }
+        t += dash_heredoc(t) ? 3 : 2;
     }
+    ps->tok = end;
     return true;
 }
 
-bool parse_name()
+static command_t *new_command(parse_state_t *ps)
 {
-    if (peek_next_token() == TOKEN_NAME)
+    command_t *cmd = parse_alloc(ps, sizeof(command_t));
+    if (cmd)
     {
-        consume_token();
-        return true;
+        memset(cmd, 0, sizeof(*cmd));
+        cmd->in_arena = ps->arena != NULL;
     }
-    return false;
+    return cmd;
 }
 
-command_t *parse_input(char *input)
+// command: a word, then words and redirections
+static command_t *parse_command(parse_state_t *ps, bool *ok)
 {
-    size_t len = strlen(input);
-    if (len > 0 && input[len - 1] == '\n')
-    {
-        input[len - 1] = '\0'; // Remove trailing newline
-    }
-    command_t *cmd = malloc(sizeof(command_t));
-    if (!cmd)
-        return NULL;
-    cmd->argc = 0;
-    cmd->background = false;
-    cmd->in_files = calloc(16, sizeof(char *));
-    cmd->in_count = 0;
-    cmd->out_files = calloc(16, sizeof(char *));
-    cmd->out_append = calloc(16, sizeof(bool));
-    cmd->out_count = 0;
-    if (!cmd->in_files || !cmd->out_files || !cmd->out_append)
-    {
-        free(cmd->in_files);
-        free(cmd->out_files);
-        free(cmd->out_append);
-        free(cmd);
+    *ok = ps->tok->type == TOKEN_NAME;
+    if (!*ok)
         return NULL;
-    }
-    cmd->argv = calloc(64, sizeof(char *));
-    if (!cmd->argv)
+    command_t *cmd = ps->build ? new_command(ps) : NULL;
+    *ok = (!ps->build || cmd) && parse_words(ps, cmd, false);
+    if (!*ok)
     {
-        free(cmd->in_files);
-        free(cmd->out_files);
-        free(cmd->out_append);
-        free(cmd);
+        free_command(cmd);
         return NULL;
     }
+    return cmd;
+}
 
-    char *copy = strdup(input);
-    if (!copy)
-    {
-        free(cmd->argv);
-        free(cmd->in_files);
-        free(cmd->out_files);
-        free(cmd->out_append);
-        free(cmd);
-        return NULL;
-    }
+// pipeline: command ("|" command)*
+static bool parse_pipeline(parse_state_t *ps, pipeline_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    const token_t *first = ps->tok;
 
-    char *token, *saveptr;
-    token = strtok_r(copy, " \t\n", &saveptr);
-    while (token && cmd->argc < 63)
+    if (ps->build)
     {
-        if (strcmp(token, "&") == 0)
-        {
-            cmd->background = true;
-            token = strtok_r(NULL, " \t\n", &saveptr);
-            continue;
-        }
-        if (token[0] == '<')
-        {
-            char *fname = token[1] ? strdup(token + 1) : strdup(strtok_r(NULL, " \t", &saveptr));
-            cmd->in_files[cmd->in_count++] = fname;
-        }
-        else if (token[0] == '>')
+        // at most one stage per "|" before the next separator
+        int stages = 1, heredocs = 0;
+        for (const token_t *t = first; t->type != TOKEN_END && t->type != TOKEN_SEMICOLON &&
+                                        t->type != TOKEN_AMPERSAND && t->type != TOKEN_DOUBLE_AMP; t++)
         {
-            bool append = token[1] == '>';
-            char *fname = append
-                              ? strdup(token[2] ? token + 2 : strtok_r(NULL, " \t", &saveptr))
-                              : strdup(token[1] ? token + 1 : strtok_r(NULL, " \t", &saveptr));
-            cmd->out_files[cmd->out_count] = fname;
-            cmd->out_append[cmd->out_count++] = append;
+            if (t->type == TOKEN_PIPE)
+                stages++;
+            else if (t->type == TOKEN_HEREDOC)
+                heredocs++;
         }
-        else
-        {
-            cmd->argv[cmd->argc++] = strdup(token);
-        }
-        token = strtok_r(NULL, " \t\n", &saveptr);
+        p->commands = parse_alloc(ps, (stages + 1) * sizeof(command_t *));
+        p->heredocs = parse_alloc(ps, (heredocs + 1) * sizeof(char *));
+        if (!p->commands || !p->heredocs)
+            return false;
+        ps->pipeline = p;
     }
-    cmd->argv[cmd->argc] = NULL;
-    free(copy);
 
-    if (cmd->argc > 0)
+    while (true)
     {
-        char *last = cmd->argv[cmd->argc - 1];
-        size_t len = strlen(last);
-        if (len && last[len - 1] == '&')
+        bool ok;
+        command_t *cmd = parse_command(ps, &ok);
+        if (!ok)
+            return false;
+        if (ps->build)
         {
-            cmd->background = true;
-            if (len == 1)
-            {
-                free(cmd->argv[--cmd->argc]);
-                cmd->argv[cmd->argc] = NULL;
-            }
-            else
-            {
-                last[len - 1] = '\0';
-            }
+            p->commands[p->count] = cmd;
+            p->commands[p->count + 1] = NULL;
         }
+        p->count++;
+
+        if (ps->tok->type != TOKEN_PIPE)
+            break;
+        ps->tok++;
     }
-    return cmd;
+    ps->pipeline = NULL;
+
+    // a trailing "&" belongs to the pipeline's text, as typed
+    const token_t *last = ps->tok - 1;
+    if (ps->tok->type == TOKEN_AMPERSAND)
+    {
+        p->background = true;
+        last = ps->tok;
+        for (int i = 0; ps->build && i < p->count; i++)
+            p->commands[i]->background = true;
+    }
+    if (ps->build)
+    {
+        p->text = parse_strndup(ps, first->start, last->start + last->len - first->start);
+        if (!p->text)
+            return false;
+    }
+    return true;
 }
 
-bool parse_output()
+// list: pipeline ((";" | "&&" | "&") pipeline)* ["&"]
+static bool parse_list(parse_state_t *ps, command_line_t *line)
 {
-    token_type nt = peek_next_token();
-    if (nt != TOKEN_GT && nt != TOKEN_DOUBLE_GT)
-        return false;
-    consume_token();
-    if (!parse_name())
+    if (ps->build)
     {
-        while (*pos && !isspace((unsigned char)*pos))
-            pos++;
-        return false;
+        // at most one pipeline per separator, plus one
+        int pipelines = 1;
+        for (const token_t *t = ps->tok; t->type != TOKEN_END; t++)
+            if (t->type == TOKEN_SEMICOLON || t->type == TOKEN_AMPERSAND || t->type == TOKEN_DOUBLE_AMP)
+                pipelines++;
+        line->pipelines = parse_alloc(ps, pipelines * sizeof(pipeline_t));
+        if (!line->pipelines)
+            return false;
+    }
+
+    bool if_success = false;
+    while (true)
+    {
+        pipeline_t p;
+        if (!parse_pipeline(ps, &p))
+            return false;
+        p.if_success = if_success;
+        if (ps->build)
+            line->pipelines[line->count] = p;
+        line->count++;
+
+        token_type sep = ps->tok->type;
+        if (sep == TOKEN_END)
+            return true;
+        if (sep != TOKEN_AMPERSAND && sep != TOKEN_SEMICOLON && sep != TOKEN_DOUBLE_AMP)
+            return false;
+        ps->tok++;
+        // only "&" may end the line
+        if (sep == TOKEN_AMPERSAND && ps->tok->type == TOKEN_END)
+            return true;
+        if_success = sep == TOKEN_DOUBLE_AMP;
     }
-    return true;
 }
 
-bool parse_input_redirection(void)
+// tokens and, when building, the whole tree live in one arena that goes back
+// to the pool in a single step once the line is done
+static command_line_t *parse_tokens(const char *input, bool build)
 {
-    if (peek_next_token() != TOKEN_LT)
-        return false;
-    consume_token();
-    if (!parse_name())
+    arena_t *arena = arena_acquire();
+    if (!arena)
+        return NULL;
+    token_list_t list = {NULL, 0, 0, arena};
+    command_line_t *line = arena_alloc(arena, sizeof(command_line_t));
+    if (!line || !tokenize(input, &list))
     {
-        while (*pos && !isspace((unsigned char)*pos))
-            pos++;
-        return false;
+        arena_release(arena);
+        return NULL;
     }
-    return true;
+    memset(line, 0, sizeof(*line));
+    line->arena = arena;
+
+    parse_state_t ps = {list.tokens, build, arena, false, NULL};
+    if (!parse_list(&ps, line))
+    {
+        arena_release(arena);
+        return NULL;
+    }
+    line->has_heredoc = ps.took_heredoc;
+    return line;
+}
+
+command_line_t *parse_line(const char *input)
+{
+    return parse_tokens(input, true);
+}
+
+void free_command_line(command_line_t *line)
+{
+    if (line)
+        arena_release(line->arena);
+}
+
+bool is_valid_syntax(char *input)
+{
+    command_line_t *line = parse_tokens(input, false);
+    free_command_line(line);
+    return line != NULL;
+}
+
+// one simple command, built with malloc so it can outlive any line; "&"
+// anywhere makes it a background one, and anything after another operator
+// is ignored
+command_t *parse_input(char *input)
+{
+    size_t len = strlen(input);
+    if (len > 0 && input[len - 1] == '\n')
+    {
+        input[len - 1] = '\0'; // Remove trailing newline
+    }
+
+    arena_t *arena = arena_acquire();
+    if (!arena)
+        return NULL;
+    token_list_t list = {NULL, 0, 0, arena};
+    parse_state_t ps = {NULL, true, NULL, false, NULL};
+    command_t *cmd = NULL;
+    if (tokenize(input, &list))
+    {
+        ps.tok = list.tokens;
+        cmd = new_command(&ps);
+        if (cmd && !parse_words(&ps, cmd, true))
+        {
+            free_command(cmd);
+            cmd = NULL;
+        }
+    }
+    arena_release(arena);
+    return cmd;
 }
 
 void free_command(command_t *cmd)
 {
-    if (!cmd)
+    // arena commands go with their line
+    if (!cmd || cmd->in_arena)
         return;
-    for (int i = 0; i < cmd->argc; i++)
+    for (int i = 0; cmd->argv && i < cmd->argc; i++)
         free(cmd->argv[i]);
     free(cmd->argv);
-    for (int i = 0; i < cmd->in_count; i++)
+    for (int i = 0; cmd->in_files && i < cmd->in_count; i++)
         free(cmd->in_files[i]);
     free(cmd->in_files);
-    for (int i = 0; i < cmd->out_count; i++)
+    free(cmd->in_here);
+    for (int i = 0; cmd->out_files && i < cmd->out_count; i++)
         free(cmd->out_files[i]);
     free(cmd->out_files);
     free(cmd->out_append);
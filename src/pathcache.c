@@ -0,0 +1,270 @@
+#include "pathcache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define PATH_CACHE_BUCKETS 256
+
+// one remembered command; dir/dir_mtime let us notice when the directory changed under us
+typedef struct path_entry {
+    char *name;
+    char *path;
+    char *dir;
+    struct timespec dir_mtime;
+    int hits;
+    struct path_entry *next;
+} path_entry_t;
+
+static path_entry_t *buckets[PATH_CACHE_BUCKETS];
+static int entry_count = 0;
+
+// the $PATH the table was built against; any change throws everything away
+static char *cached_path_var = NULL;
+
+static unsigned int hash_name(const char *s)
+{
+    unsigned int h = 2166136261u;
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h & (PATH_CACHE_BUCKETS - 1);
+}
+
+static void free_entry(path_entry_t *e)
+{
+    free(e->name);
+    free(e->path);
+    free(e->dir);
+    free(e);
+}
+
+void path_cache_clear(void)
+{
+    for (int i = 0; i < PATH_CACHE_BUCKETS; i++)
+    {
+        path_entry_t *e = buckets[i];
+        while (e)
+        {
+            path_entry_t *next = e->next;
+            free_entry(e);
+            e = next;
+        }
+        buckets[i] = NULL;
+    }
+    entry_count = 0;
+}
+
+void path_cache_forget(const char *name)
+{
+    path_entry_t **link = &buckets[hash_name(name)];
+    while (*link)
+    {
+        if (strcmp((*link)->name, name) == 0)
+        {
+            path_entry_t *dead = *link;
+            *link = dead->next;
+            free_entry(dead);
+            entry_count--;
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+static path_entry_t *find_entry(const char *name)
+{
+    for (path_entry_t *e = buckets[hash_name(name)]; e; e = e->next)
+    {
+        if (strcmp(e->name, name) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+static path_entry_t *insert_entry(const char *name, const char *path, const char *dir,
+                                  const struct timespec *dir_mtime)
+{
+    path_cache_forget(name);
+
+    path_entry_t *e = calloc(1, sizeof(path_entry_t));
+    if (!e)
+        return NULL;
+    e->name = strdup(name);
+    e->path = strdup(path);
+    e->dir = dir ? strdup(dir) : NULL;
+    if (!e->name || !e->path || (dir && !e->dir))
+    {
+        free_entry(e);
+        return NULL;
+    }
+    if (dir_mtime)
+        e->dir_mtime = *dir_mtime;
+
+    unsigned int b = hash_name(name);
+    e->next = buckets[b];
+    buckets[b] = e;
+    entry_count++;
+    return e;
+}
+
+// throw the table away if $PATH is not what it was built against
+static void check_path_var(void)
+{
+    const char *path_var = getenv("PATH");
+    if (!path_var)
+        path_var = "";
+    if (cached_path_var && strcmp(cached_path_var, path_var) == 0)
+        return;
+
+    path_cache_clear();
+    free(cached_path_var);
+    cached_path_var = strdup(path_var);
+}
+
+static bool is_executable_file(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
+
+static bool same_mtime(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+// walk $PATH the way execvp would, but only with stat/access instead of failed execs
+static path_entry_t *search_path(const char *name)
+{
+    char candidate[PATH_MAX];
+    const char *p = cached_path_var;
+
+    while (p)
+    {
+        const char *colon = strchr(p, ':');
+        size_t dir_len = colon ? (size_t)(colon - p) : strlen(p);
+        char dir[PATH_MAX];
+
+        // an empty element means the current directory
+        if (dir_len == 0)
+            strcpy(dir, ".");
+        else if (dir_len < sizeof(dir))
+        {
+            memcpy(dir, p, dir_len);
+            dir[dir_len] = '\0';
+        }
+        else
+            dir[0] = '\0';
+
+        if (dir[0] && snprintf(candidate, sizeof(candidate), "%s/%s", dir, name) < (int)sizeof(candidate) &&
+            is_executable_file(candidate))
+        {
+            // relative entries depend on the cwd, so they are never remembered
+            if (dir[0] != '/')
+            {
+                static path_entry_t uncached;
+                static char uncached_path[PATH_MAX];
+                strcpy(uncached_path, candidate);
+                uncached.path = uncached_path;
+                return &uncached;
+            }
+
+            struct stat dst;
+            if (stat(dir, &dst) != 0)
+                return NULL;
+            return insert_entry(name, candidate, dir, &dst.st_mtim);
+        }
+
+        p = colon ? colon + 1 : NULL;
+    }
+    return NULL;
+}
+
+const char *path_lookup(const char *name)
+{
+    if (!name || !*name)
+        return NULL;
+    if (strchr(name, '/'))
+        return name;
+
+    check_path_var();
+
+    path_entry_t *e = find_entry(name);
+    if (e)
+    {
+        // entries seeded with hash -p have no directory to watch
+        struct stat dst;
+        if (!e->dir || (stat(e->dir, &dst) == 0 && same_mtime(&dst.st_mtim, &e->dir_mtime)))
+        {
+            e->hits++;
+            return e->path;
+        }
+        path_cache_forget(name);
+    }
+
+    e = search_path(name);
+    if (!e)
+        return NULL;
+    e->hits++;
+    return e->path;
+}
+
+static void print_table(void)
+{
+    if (entry_count == 0)
+    {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    printf("hits\tcommand\n");
+    for (int i = 0; i < PATH_CACHE_BUCKETS; i++)
+    {
+        for (path_entry_t *e = buckets[i]; e; e = e->next)
+            printf("%4d\t%s\n", e->hits, e->path);
+    }
+}
+
+void execute_hash(char **args)
+{
+    check_path_var();
+
+    if (args[1] == NULL)
+    {
+        print_table();
+        return;
+    }
+
+    int i = 1;
+    if (strcmp(args[i], "-r") == 0)
+    {
+        path_cache_clear();
+        i++;
+    }
+
+    if (args[i] && strcmp(args[i], "-p") == 0)
+    {
+        if (!args[i + 1] || !args[i + 2])
+        {
+            printf("Usage: hash -p <path> <name>\n");
+            return;
+        }
+        insert_entry(args[i + 2], args[i + 1], NULL, NULL);
+        return;
+    }
+
+    // pre-seed: resolve now so later launches skip the $PATH walk
+    for (; args[i] != NULL; i++)
+    {
+        if (strchr(args[i], '/'))
+            continue;
+        path_cache_forget(args[i]);
+        path_entry_t *e = search_path(args[i]);
+        if (!e)
+            printf("hash: %s: not found\n", args[i]);
+    }
+}
@@ -1,46 +1,223 @@
+// wait4 is a BSD interface, F_SETPIPE_SZ a Linux one
+#define _GNU_SOURCE
 #include "pipe.h"
 #include "exec.h"
-#include "hop.h"
-#include "reveal.h"
-#include "log.h"
-#include "globals.h"
+#include "builtins.h"
 #include "jobs.h"
+#include "spawner.h"
+#include "signals.h"
+#include "timing.h"
+#include "launch.h"
+#include "pipestat.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <ctype.h>
 
-// helper function to check if command is a builtin
-static int is_builtin(const char *cmd) {
-    return (strcmp(cmd, "hop") == 0 ||
-            strcmp(cmd, "reveal") == 0 ||
-            strcmp(cmd, "log") == 0 ||
-            strcmp(cmd, "echo") == 0);
+size_t pipe_buffer_size = 0;
+
+// builtin stages that can't run on a thread (hop, parallel, ...) still get a
+// child of their own. in_fd/out_fd are the stage's ends: the neighbouring
+// pipes or the validated redirections
+static pid_t fork_builtin_stage(builtin_fn fn, command_t *cmd, int in_fd, int out_fd, pid_t pgid)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork failed");
+        return -1;
+    }
+    if (pid > 0)
+    {
+        // both sides set the group so it holds whichever runs first
+        setpgid(pid, pgid);
+        return pid;
+    }
+
+    // child; everything else we hold is close-on-exec but we never exec, and
+    // a stray write end (say, a writer thread's) would keep its reader from
+    // ever seeing EOF. So keep the two ends and drop the rest
+    setpgid(0, pgid);
+
+    if (in_fd != -1)
+        dup2(in_fd, STDIN_FILENO);
+    if (out_fd != -1)
+        dup2(out_fd, STDOUT_FILENO);
+    if (close_range(3, ~0U, 0) < 0)
+    {
+        for (int fd = 3; fd < 1024; fd++)
+            close(fd);
+    }
+
+    fn(cmd->argv, stdout);
+    // stdout is a pipe here, so it is fully buffered and _exit would drop it
+    fflush(stdout);
+    _exit(EXIT_SUCCESS);
+}
+
+// external stages go through the spawn layer; returns -1 with errno == 0 when
+// the stage could not start but the rest of the pipeline should still run
+static pid_t spawn_external_stage(command_t *cmd, int in_fd, int out_fd, pid_t pgid, bool background)
+{
+    spawn_request_t req;
+    spawn_request_init(&req, cmd->argv);
+    req.in_fd = in_fd;
+    req.out_fd = out_fd;
+    req.pgid = pgid;
+    req.attrs = launch_attrs_for(background);
+
+    pid_t pid = spawn_process(&req);
+    if (pid < 0)
+    {
+        int err = errno;
+        spawn_report_failure(cmd->argv[0], err);
+        // the program itself is at fault; anything else (no memory, no
+        // processes left) stops the whole pipeline
+        if (err == ENOENT || err == EACCES || err == ENOEXEC || err == ENOTDIR || err == EISDIR)
+            errno = 0;
+        else
+            errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+size_t pipe_max_size(void)
+{
+    static size_t max_size = 0;
+    if (max_size)
+        return max_size;
+
+    // the kernel's own default if /proc isn't there
+    max_size = 1024 * 1024;
+    FILE *f = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if (f)
+    {
+        unsigned long value;
+        if (fscanf(f, "%lu", &value) == 1 && value > 0)
+            max_size = value;
+        fclose(f);
+    }
+    return max_size;
+}
+
+// "256K", "1M", "max", "default"; returns false on anything else
+static bool parse_pipe_size(const char *s, size_t *size)
+{
+    if (strcmp(s, "max") == 0)
+    {
+        *size = pipe_max_size();
+        return true;
+    }
+    if (strcmp(s, "default") == 0)
+    {
+        *size = 0;
+        return true;
+    }
+
+    char *end;
+    unsigned long long value = strtoull(s, &end, 10);
+    if (end == s)
+        return false;
+    if (*end == 'k' || *end == 'K')
+        value <<= 10, end++;
+    else if (*end == 'm' || *end == 'M')
+        value <<= 20, end++;
+    if (*end != '\0' || value == 0)
+        return false;
+
+    // asking for more than pipe-max-size fails with EPERM; take what we can get
+    *size = value > pipe_max_size() ? pipe_max_size() : (size_t)value;
+    return true;
+}
+
+void execute_pipebuf(char *line, void (*run_command)(char *))
+{
+    char *p = line;
+    while (*p && isspace((unsigned char)*p))
+        p++;
+    if (*p == '\0')
+    {
+        if (pipe_buffer_size)
+            printf("pipe buffer: %zu bytes (max %zu)\n", pipe_buffer_size, pipe_max_size());
+        else
+            printf("pipe buffer: default (max %zu)\n", pipe_max_size());
+        return;
+    }
+
+    char *word = p;
+    while (*p && !isspace((unsigned char)*p))
+        p++;
+    if (*p)
+        *p++ = '\0';
+    while (*p && isspace((unsigned char)*p))
+        p++;
+
+    size_t size;
+    if (!parse_pipe_size(word, &size))
+    {
+        printf("Usage: pipebuf [<bytes>[K|M] | max | default] [pipeline]\n");
+        last_exit_status = 2;
+        return;
+    }
+
+    if (*p == '\0')
+    {
+        pipe_buffer_size = size;
+        return;
+    }
+
+    // just this pipeline
+    size_t saved = pipe_buffer_size;
+    pipe_buffer_size = size;
+    run_command(p);
+    pipe_buffer_size = saved;
 }
 
-// helper function to execute builtin commands in pipeline
-static void execute_builtin_in_pipe(command_t *cmd, const char *home_dir) {
-    if (strcmp(cmd->argv[0], "hop") == 0) {
-        execute_hop(cmd->argv, home_dir);
-    } else if (strcmp(cmd->argv[0], "reveal") == 0) {
-        execute_reveal(cmd->argv, home_dir);
-    } else if (strcmp(cmd->argv[0], "log") == 0) {
-        // for log in pipeline, we need a dummy function pointer
-        void dummy_run_command(char *c) { /* empty */ }
-        execute_log(cmd->argv, home_dir, dummy_run_command);
-    } else if (strcmp(cmd->argv[0], "echo") == 0) {
-        for (int i = 1; cmd->argv[i] != NULL; i++) {
-            printf("%s", cmd->argv[i]);
-            if (cmd->argv[i + 1] != NULL)
-                printf(" ");
+// "grep x | sort -u" for the job table
+static char *pipeline_text(command_t **commands, int count)
+{
+    size_t len = 1;
+    for (int i = 0; i < count; i++)
+        for (int a = 0; commands[i]->argv[a]; a++)
+            len += strlen(commands[i]->argv[a]) + 3;
+
+    char *text = malloc(len);
+    if (!text)
+        return NULL;
+    text[0] = '\0';
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            strcat(text, " | ");
+        for (int a = 0; commands[i]->argv[a]; a++)
+        {
+            if (a > 0)
+                strcat(text, " ");
+            strcat(text, commands[i]->argv[a]);
         }
-        printf("\n");
     }
+    return text;
 }
 
+// where a stage runs: a child (pid), a writer thread (task), or the shell
+// itself (a foreground pipeline's last builtin, like bash's lastpipe)
+typedef struct {
+    pid_t pid;
+    bg_task_t *task;
+    int task_status;    // the writer thread's exit status, once finished
+    bool in_shell;
+    bool reaped;
+    double started;
+    double wall;
+    struct rusage usage;
+} pipe_stage_t;
+
 void execute_pipeline(command_t **commands, bool background)
 {
     if (!commands || !commands[0])
@@ -50,132 +227,281 @@ void execute_pipeline(command_t **commands, bool background)
     while (commands[num_commands] != NULL)
         num_commands++;
         
-    pid_t pids[num_commands];
-    int prev_read_fd = -1;
+    // input redirection (only for first command in pipeline) and output
+    // redirection (only for last command) are opened once, up front
+    redir_t first_redir, last_redir;
+    if (open_redirections(commands[0], REDIR_INPUT, &first_redir) < 0)
+    {
+        last_exit_status = 1;
+        return;
+    }
+    if (open_redirections(commands[num_commands - 1], REDIR_OUTPUT, &last_redir) < 0)
+    {
+        close_redirections(&first_redir);
+        last_exit_status = 1;
+        return;
+    }
+
+    // one entry per stage, however many there are; only the pipe between
+    // the current stage and the next is open at any time
+    pipe_stage_t *stages = calloc(num_commands, sizeof(pipe_stage_t));
+    if (!stages)
+    {
+        perror("malloc");
+        close_redirections(&first_redir);
+        close_redirections(&last_redir);
+        return;
+    }
+    int prev_read_fd = first_redir.in_fd;
+    first_redir.in_fd = -1;
+    int shell_status = 0;
+    bool aborted = false;
+
+    // pipestat: links[i] relays stage i's output to stage i + 1. Off, this
+    // costs nothing but the check
+    pipestat_link_t **links = NULL;
+    if (pipestat_active && !background && num_commands > 1)
+        links = calloc(num_commands, sizeof(pipestat_link_t *));
+
+    // every process of the pipeline joins the first one's group, so one
+    // kill(-pgid) reaches them all and the terminal can be handed over at once
+    extern pid_t fg_pid;
+    pid_t pgid = 0;
     
     for (int i = 0; i < num_commands; i++)
     {
         int pipefd[2] = {-1, -1};
+        bool last = (i == num_commands - 1);
         
-        if (i < num_commands - 1)
+        if (!last)
         {
             if (pipe(pipefd) == -1)
             {
                 perror("pipe failed");
-                if (prev_read_fd != -1)
-                    close(prev_read_fd);
-                return;
+                aborted = true;
+                break;
             }
         }
         
-        pid_t pid = fork();
-        if (pid < 0)
+        // keep pipe ends out of unrelated children; stages get theirs via dup2
+        if (pipefd[0] != -1)
+        {
+            fcntl(pipefd[0], F_SETFD, FD_CLOEXEC);
+            fcntl(pipefd[1], F_SETFD, FD_CLOEXEC);
+            // throughput mode: fewer, larger transfers between stages. A refusal
+            // (e.g. the per-user pipe quota is used up) just keeps the default
+            if (pipe_buffer_size)
+                fcntl(pipefd[1], F_SETPIPE_SZ, (int)pipe_buffer_size);
+        }
+
+        int out_fd = last ? last_redir.out_fd : pipefd[1];
+
+        pid_t pid = 0;
+        stages[i].started = timing_now();
+        // jobs, fg and the like act on the shell; as a stage they are
+        // looked up like any other program
+        const builtin_t *builtin = builtin_for(commands[i], i > 0);
+        if (builtin && builtin->kind == BUILTIN_SHELL)
+            builtin = NULL;
+        if (builtin && last && !background)
+        {
+            // everything upstream is already running, so this can't deadlock
+            redir_t io = {prev_read_fd, out_fd, NULL};
+            last_exit_status = 0;
+            run_builtin_foreground(builtin->run, commands[i]->argv, &io);
+            shell_status = last_exit_status;
+            stages[i].wall = timing_now() - stages[i].started;
+            stages[i].in_shell = true;
+        }
+        // a background pipeline stays a single process group that can be
+        // stopped and signalled as a whole, so its builtins get children
+        else if (builtin && !background && builtin_runs_in_thread(builtin, commands[i]->argv) &&
+                 (stages[i].task = builtin_start_writer(builtin, commands[i]->argv, out_fd)) != NULL)
+        {
+            // the worker writes through its own dup of out_fd; its input is unused
+        }
+        else if (builtin)
+            pid = fork_builtin_stage(builtin->run, commands[i], prev_read_fd, out_fd, pgid);
+        else
+            pid = spawn_external_stage(commands[i], prev_read_fd, out_fd, pgid, background);
+
+        if (pid < 0 && errno != 0)
         {
-            perror("fork failed");
-            if (prev_read_fd != -1)
-                close(prev_read_fd);
             if (pipefd[0] != -1)
                 close(pipefd[0]);
             if (pipefd[1] != -1)
                 close(pipefd[1]);
-            return;
+            aborted = true;
+            break;
         }
         
-        if (pid == 0)
+        // parent
+        stages[i].pid = pid;
+        if (pid > 0 && pgid == 0)
         {
-            // child
-            setpgid(0, 0);
-            
-            // input from previous pipe
-            if (prev_read_fd != -1)
-            {
-                dup2(prev_read_fd, STDIN_FILENO);
-                close(prev_read_fd);
-            }
-            
-            // output to next pipe
-            if (pipefd[1] != -1)
-            {
-                dup2(pipefd[1], STDOUT_FILENO);
-                close(pipefd[0]);
-                close(pipefd[1]);
-            }
-            
-            // input redirection (only for first command in pipeline)
-            if (i == 0 && commands[i]->in_count > 0)
+            pgid = pid;
+            if (!background)
             {
-                const char *infile = commands[i]->in_files[commands[i]->in_count - 1];
-                int fd_in = open(infile, O_RDONLY);
-                if (fd_in < 0)
-                {
-                    perror(infile);
-                    _exit(EXIT_FAILURE);
-                }
-                dup2(fd_in, STDIN_FILENO);
-                close(fd_in);
-            }
-            
-            // output redirection (only for last command in pipeline)
-            if (i == num_commands - 1 && commands[i]->out_count > 0)
-            {
-                const char *outfile = commands[i]->out_files[commands[i]->out_count - 1];
-                bool append = commands[i]->out_append[commands[i]->out_count - 1];
-                int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
-                int fd_out = open(outfile, flags, 0644);
-                if (fd_out < 0)
-                {
-                    perror(outfile);
-                    _exit(EXIT_FAILURE);
-                }
-                dup2(fd_out, STDOUT_FILENO);
-                close(fd_out);
-            }
-            
-            // execute command - handle builtins specially
-            if (is_builtin(commands[i]->argv[0]))
-            {
-                execute_builtin_in_pipe(commands[i], getenv("HOME"));
-                _exit(EXIT_SUCCESS);
-            }
-            else
-            {
-                execvp(commands[i]->argv[0], commands[i]->argv);
-                fprintf(stderr, "Command not found!\n");
-                _exit(EXIT_FAILURE);
+                // Ctrl-C / Ctrl-Z now go to the pipeline, not the shell
+                tcsetpgrp(STDIN_FILENO, pgid);
+                fg_pid = pgid;
             }
         }
         
-        // parent
-        pids[i] = pid;
-        
         if (prev_read_fd != -1)
             close(prev_read_fd);
+        prev_read_fd = -1;
             
         if (pipefd[0] != -1)
         {
             close(pipefd[1]);
             prev_read_fd = pipefd[0];
+            // without a relay the stages just share the one pipe
+            if (links)
+                links[i] = pipestat_link_start(pipefd[0], &prev_read_fd);
         }
     }
     
     if (prev_read_fd != -1)
         close(prev_read_fd);
+    // a fan-out relay behind the last stage is waited for with the stages
+    if (background)
+        close_redirections(&last_redir);
+
+    // stages that did start run to completion; ours just never get input
+    int child_count = 0;
+    for (int i = 0; i < num_commands; i++)
+        if (stages[i].pid > 0)
+            child_count++;
         
     if (!background)
     {
-        for (int i = 0; i < num_commands; i++)
+        // reap stages in whatever order they finish so each one's wall time is
+        // accurate. Only our group is waited for; other children are left to
+        // the job table's own reaping
+        int last_status = 0;
+        int remaining = child_count;
+        bool stopped = false;
+
+        while (remaining > 0)
         {
             int status;
-            while (waitpid(pids[i], &status, 0) == -1 && errno == EINTR)
-                ;
+            struct rusage ru;
+            pid_t pid = wait4(-pgid, &status, WUNTRACED, &ru);
+            if (pid < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            int stage = -1;
+            for (int i = 0; i < num_commands; i++)
+            {
+                if (stages[i].pid == pid)
+                {
+                    stage = i;
+                    break;
+                }
+            }
+            if (stage < 0)
+                continue;
+            if (WIFSTOPPED(status))
+            {
+                // Ctrl-Z stopped the whole group: it becomes one stopped job
+                stopped = true;
+                last_status = status;
+                break;
+            }
+            stages[stage].wall = timing_now() - stages[stage].started;
+            stages[stage].reaped = true;
+            if (stage == num_commands - 1)
+                last_status = status;
+            stages[stage].usage = ru;
+            remaining--;
+        }
+
+        if (pgid > 0)
+        {
+            tcsetpgrp(STDIN_FILENO, getpgrp());
+            fg_pid = -1;
         }
+
+        if (stopped)
+        {
+            pid_t *alive = malloc(child_count * sizeof(pid_t));
+            char *text = pipeline_text(commands, num_commands);
+            int n = 0;
+            for (int i = 0; alive && i < num_commands; i++)
+                if (stages[i].pid > 0 && !stages[i].reaped)
+                    alive[n++] = stages[i].pid;
+            if (alive && text && n > 0)
+                jobs_add_group(pgid, alive, n, text, STOPPED);
+            free(alive);
+            free(text);
+            // writers may be blocked on the stopped readers, so they become jobs too
+            for (int i = 0; i < num_commands; i++)
+                if (stages[i].task)
+                    jobs_add_task(stages[i].task, commands[i]->argv[0]);
+            close_redirections(&last_redir);
+            if (links)
+                pipestat_abandon(links, num_commands);
+            free(links);
+            last_exit_status = exit_code_from_status(last_status);
+            free(stages);
+            return;
+        }
+
+        // writer threads are done once their readers are; their CPU time is
+        // part of the shell's own, which "time" adds to the total
+        for (int i = 0; i < num_commands; i++)
+        {
+            if (stages[i].task)
+            {
+                stages[i].task_status = bg_task_finish(stages[i].task);
+                stages[i].wall = timing_now() - stages[i].started;
+            }
+        }
+
+        wait_redirections(&last_redir);
+        if (links)
+        {
+            pipestat_finish(links, commands, num_commands);
+            free(links);
+        }
+
+        for (int i = 0; i < num_commands; i++)
+            if (stages[i].pid > 0 || stages[i].task || stages[i].in_shell)
+                timing_record(commands[i]->argv[0], stages[i].wall, &stages[i].usage);
+
+        // like sh, a pipeline's status is that of its last stage
+        pipe_stage_t *last = &stages[num_commands - 1];
+        if (aborted)
+            last_exit_status = 1;
+        else if (last->in_shell)
+            last_exit_status = shell_status;
+        else if (last->pid > 0)
+            last_exit_status = exit_code_from_status(last_status);
+        else
+            last_exit_status = last->task ? last->task_status : 127;
     }
     else
     {
-        // add all pipeline processes as background jobs
-        for (int i = 0; i < num_commands; i++)
+        // one job for the whole pipeline, whatever the number of stages
+        if (child_count > 0)
         {
-            jobs_add(pids[i], commands[i]->argv[0]);
+            pid_t *pids = malloc(child_count * sizeof(pid_t));
+            char *text = pipeline_text(commands, num_commands);
+            int n = 0;
+            for (int i = 0; pids && i < num_commands; i++)
+                if (stages[i].pid > 0)
+                    pids[n++] = stages[i].pid;
+            if (pids && text)
+                jobs_add_group(pgid, pids, n, text, RUNNING);
+            free(pids);
+            free(text);
         }
+        last_exit_status = aborted ? 1 : 0;
     }
-}
\ No newline at end of file
+    free(stages);
+}
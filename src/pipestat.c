@@ -0,0 +1,225 @@
+// splice is a Linux interface
+#define _GNU_SOURCE
+#include "pipestat.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+
+#define RELAY_CHUNK (1 << 20)
+
+bool pipestat_active = false;
+
+struct pipestat_link {
+    pthread_t thread;
+    int in_fd;
+    int out_fd;
+    // written by the relay, read after the join
+    unsigned long long bytes;
+    double started;
+    double finished;
+    double starved;     // waiting for the upstream stage to write
+    double blocked;     // waiting for the downstream stage to read
+    // an abandoned relay is freed by whichever of it and the shell is last
+    pthread_mutex_t lock;
+    bool done;
+    bool abandoned;
+};
+
+static double wait_for(int fd, short events)
+{
+    struct pollfd p = {fd, events, 0};
+    double t0 = timing_now();
+    while (poll(&p, 1, -1) < 0 && errno == EINTR)
+        ;
+    return timing_now() - t0;
+}
+
+static void link_free(pipestat_link_t *link)
+{
+    pthread_mutex_destroy(&link->lock);
+    free(link);
+}
+
+static void *relay_main(void *arg)
+{
+    pipestat_link_t *link = arg;
+
+    while (true)
+    {
+        ssize_t n = splice(link->in_fd, NULL, link->out_fd, NULL, RELAY_CHUNK,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0)
+        {
+            link->bytes += n;
+            continue;
+        }
+        if (n == 0)
+            break;
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN)
+            break;      // EPIPE: the reader is gone
+
+        // nothing to move: either the writer hasn't produced or the reader is full
+        struct pollfd in = {link->in_fd, POLLIN, 0};
+        if (poll(&in, 1, 0) > 0)
+            link->blocked += wait_for(link->out_fd, POLLOUT);
+        else
+            link->starved += wait_for(link->in_fd, POLLIN);
+    }
+
+    link->finished = timing_now();
+    // closing both ends passes EOF on downstream and EPIPE back upstream
+    close(link->in_fd);
+    close(link->out_fd);
+
+    pthread_mutex_lock(&link->lock);
+    link->done = true;
+    bool abandoned = link->abandoned;
+    pthread_mutex_unlock(&link->lock);
+    if (abandoned)
+        link_free(link);
+    return NULL;
+}
+
+pipestat_link_t *pipestat_link_start(int in_fd, int *out_fd)
+{
+    pipestat_link_t *link = calloc(1, sizeof(pipestat_link_t));
+    int relay[2];
+    if (!link || pipe2(relay, O_CLOEXEC) < 0)
+    {
+        free(link);
+        return NULL;
+    }
+
+    // only the relay uses these two ends, so non-blocking mode is ours alone
+    fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(relay[1], F_SETFL, fcntl(relay[1], F_GETFL) | O_NONBLOCK);
+    // same capacity as the pipe it sits behind
+    fcntl(relay[1], F_SETPIPE_SZ, fcntl(in_fd, F_GETPIPE_SZ));
+
+    link->in_fd = in_fd;
+    link->out_fd = relay[1];
+    link->started = timing_now();
+    pthread_mutex_init(&link->lock, NULL);
+
+    // no signals for the relay, SIGPIPE included: a closed reader is just EPIPE
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int err = pthread_create(&link->thread, NULL, relay_main, link);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err != 0)
+    {
+        fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) & ~O_NONBLOCK);
+        close(relay[0]);
+        close(relay[1]);
+        link_free(link);
+        return NULL;
+    }
+
+    *out_fd = relay[0];
+    return link;
+}
+
+void pipestat_abandon(pipestat_link_t **links, int count)
+{
+    // the relays finish on their own and free themselves; one that is
+    // already through is ours to free
+    for (int i = 0; i < count; i++)
+    {
+        pipestat_link_t *link = links[i];
+        if (!link)
+            continue;
+        links[i] = NULL;
+        pthread_detach(link->thread);
+        pthread_mutex_lock(&link->lock);
+        link->abandoned = true;
+        bool done = link->done;
+        pthread_mutex_unlock(&link->lock);
+        if (done)
+            link_free(link);
+    }
+}
+
+void pipestat_finish(pipestat_link_t **links, command_t **commands, int count)
+{
+    bool any = false;
+    for (int i = 0; i < count; i++)
+    {
+        if (links[i])
+        {
+            pthread_join(links[i]->thread, NULL);
+            any = true;
+        }
+    }
+    if (!any)
+        return;
+
+    // keep the report after whatever the pipeline printed
+    fflush(stdout);
+    fprintf(stderr, "%-6s %-25s %14s %10s %10s %10s\n",
+            "link", "stages", "bytes", "MB/s", "starved", "blocked");
+
+    // a stage holds up its neighbours twice over: the link before it backs
+    // up (blocked) and the link after it runs dry (starved)
+    int bottleneck = -1;
+    double worst = 0;
+    for (int s = 0; s < count; s++)
+    {
+        double held = 0;
+        if (s > 0 && links[s - 1])
+            held += links[s - 1]->blocked;
+        if (s < count - 1 && links[s])
+            held += links[s]->starved;
+        if (held > worst)
+        {
+            worst = held;
+            bottleneck = s;
+        }
+    }
+
+    for (int i = 0; i < count - 1; i++)
+    {
+        pipestat_link_t *link = links[i];
+        if (!link)
+            continue;
+        char stages[64];
+        snprintf(stages, sizeof(stages), "%.11s -> %.11s", commands[i]->argv[0], commands[i + 1]->argv[0]);
+        double elapsed = link->finished - link->started;
+        double rate = elapsed > 0 ? link->bytes / (1024.0 * 1024.0) / elapsed : 0;
+        char label[16];
+        snprintf(label, sizeof(label), "%d", i + 1);
+        fprintf(stderr, "%-6s %-25s %14llu %10.1f %9.3fs %9.3fs\n",
+                label, stages, link->bytes, rate, link->starved, link->blocked);
+        link_free(link);
+        links[i] = NULL;
+    }
+    if (bottleneck >= 0)
+        fprintf(stderr, "slowest stage: %d (%s), held up its neighbours for %.3fs\n",
+                bottleneck + 1, commands[bottleneck]->argv[0], worst);
+}
+
+void execute_pipestat(char *line, void (*run_command)(char *))
+{
+    while (*line && isspace((unsigned char)*line))
+        line++;
+    if (*line == '\0')
+    {
+        printf("Usage: pipestat <pipeline>\n");
+        return;
+    }
+
+    bool saved = pipestat_active;
+    pipestat_active = true;
+    run_command(line);
+    pipestat_active = saved;
+}
@@ -21,7 +21,7 @@ int compare_strings(const void *a, const void *b)
     return strcmp(str_a, str_b);
 }
 
-void execute_reveal(char **args, const char *home_dir)
+void execute_reveal(char **args, const char *home_dir, FILE *out)
 {
     bool show_all = false;
     bool line_by_line = false;
@@ -48,7 +48,7 @@ void execute_reveal(char **args, const char *home_dir)
                     line_by_line = true;
                 else
                 {
-                    printf("reveal: Invalid Syntax!\n");
+                    fprintf(out, "reveal: Invalid Syntax!\n");
                     return;
                 }
             }
@@ -59,7 +59,7 @@ void execute_reveal(char **args, const char *home_dir)
             path_count++;
             if (path_count > 1)
             {
-                printf("reveal: Invalid Syntax!\n");
+                fprintf(out, "reveal: Invalid Syntax!\n");
                 return;
             }
 
@@ -73,7 +73,7 @@ void execute_reveal(char **args, const char *home_dir)
                 // Access the global prev_dir directly (it's declared in globals.h)
                 if (strlen(prev_dir) == 0)
                 {
-                    printf("No such directory!\n");
+                    fprintf(out, "No such directory!\n");
                     return;
                 }
                 strcpy(target_path, prev_dir);
@@ -93,7 +93,7 @@ void execute_reveal(char **args, const char *home_dir)
         // It's a relative path, get current directory first
         if (getcwd(abs_path, sizeof(abs_path)) == NULL)
         {
-            printf("No such directory!\n");
+            fprintf(out, "No such directory!\n");
             return;
         }
 
@@ -106,7 +106,7 @@ void execute_reveal(char **args, const char *home_dir)
             
             if (current_len + 1 + target_len >= MAX_PATH_LEN)
             {
-                printf("No such directory!\n");
+                fprintf(out, "No such directory!\n");
                 return;
             }
 
@@ -128,7 +128,7 @@ void execute_reveal(char **args, const char *home_dir)
     dir_stream = opendir(target_path);
     if (dir_stream == NULL)
     {
-        printf("No such directory!\n");
+        fprintf(out, "No such directory!\n");
         return;
     }
 
@@ -170,16 +170,16 @@ void execute_reveal(char **args, const char *home_dir)
     // print the sorted list based on the -l flag
     for (int i = 0; i < file_count; i++)
     {
-        printf("%s", file_list[i]);
+        fprintf(out, "%s", file_list[i]);
         if (line_by_line)
         {
-            printf("\n");
+            fprintf(out, "\n");
         }
         else
         {
             if (i < file_count - 1)
             {
-                printf(" "); // print a space until the last entry
+                fprintf(out, " "); // print a space until the last entry
             }
         }
 
@@ -189,7 +189,7 @@ void execute_reveal(char **args, const char *home_dir)
 
     if (!line_by_line && file_count > 0)
     {
-        printf("\n");
+        fprintf(out, "\n");
     }
 
     free(file_list);
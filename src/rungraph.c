@@ -0,0 +1,411 @@
+#include "rungraph.h"
+#include "jobs.h"
+#include "signals.h"
+#include "log.h"
+#include "exec.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+typedef enum { NODE_WAITING, NODE_RUNNING, NODE_DONE, NODE_FAILED, NODE_SKIPPED } node_state_t;
+
+typedef struct {
+    char *name;
+    char *command;      // NULL for a target that only groups its deps
+    char **dep_names;
+    int dep_count;
+
+    int *dependents;    // indices of nodes that list this one as a dep
+    int dependent_count;
+    int pending;        // deps not finished yet
+    node_state_t state;
+    pid_t pid;
+    double started;
+} graph_node_t;
+
+typedef struct {
+    graph_node_t *nodes;
+    int count;
+    int capacity;
+} graph_t;
+
+static char *trim(char *s)
+{
+    while (*s && isspace((unsigned char)*s))
+        s++;
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1]))
+        s[--len] = '\0';
+    return s;
+}
+
+static int find_node(graph_t *g, const char *name)
+{
+    for (int i = 0; i < g->count; i++)
+    {
+        if (strcmp(g->nodes[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void free_graph(graph_t *g)
+{
+    for (int i = 0; i < g->count; i++)
+    {
+        graph_node_t *n = &g->nodes[i];
+        free(n->name);
+        free(n->command);
+        for (int d = 0; d < n->dep_count; d++)
+            free(n->dep_names[d]);
+        free(n->dep_names);
+        free(n->dependents);
+    }
+    free(g->nodes);
+}
+
+// "target: deps; command" -> a new node. returns false on a malformed line
+static bool parse_graph_line(graph_t *g, char *line, int lineno, FILE *out)
+{
+    char *colon = strchr(line, ':');
+    if (!colon)
+    {
+        fprintf(out, "rungraph: line %d: expected \"target: deps; command\"\n", lineno);
+        return false;
+    }
+    *colon = '\0';
+    char *name = trim(line);
+    char *rest = colon + 1;
+    char *command = NULL;
+    char *semi = strchr(rest, ';');
+    if (semi)
+    {
+        *semi = '\0';
+        command = trim(semi + 1);
+        if (*command == '\0')
+            command = NULL;
+    }
+
+    if (*name == '\0' || strpbrk(name, " \t"))
+    {
+        fprintf(out, "rungraph: line %d: bad target name\n", lineno);
+        return false;
+    }
+    if (find_node(g, name) >= 0)
+    {
+        fprintf(out, "rungraph: line %d: duplicate target %s\n", lineno, name);
+        return false;
+    }
+
+    if (g->count == g->capacity)
+    {
+        int cap = g->capacity ? g->capacity * 2 : 16;
+        graph_node_t *grown = realloc(g->nodes, cap * sizeof(graph_node_t));
+        if (!grown)
+            return false;
+        g->nodes = grown;
+        g->capacity = cap;
+    }
+    graph_node_t *n = &g->nodes[g->count++];
+    memset(n, 0, sizeof(*n));
+    n->name = strdup(name);
+    n->command = command ? strdup(command) : NULL;
+
+    char *saveptr;
+    for (char *dep = strtok_r(rest, " \t", &saveptr); dep; dep = strtok_r(NULL, " \t", &saveptr))
+    {
+        char **grown = realloc(n->dep_names, (n->dep_count + 1) * sizeof(char *));
+        if (!grown)
+            return false;
+        n->dep_names = grown;
+        n->dep_names[n->dep_count++] = strdup(dep);
+    }
+    return true;
+}
+
+static bool load_graph(graph_t *g, const char *path, FILE *out)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(out, "rungraph: %s: No such file or directory\n", path);
+        return false;
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    int lineno = 0;
+    bool ok = true;
+    while (ok && getline(&line, &cap, f) >= 0)
+    {
+        lineno++;
+        char *t = trim(line);
+        if (*t == '\0' || *t == '#')
+            continue;
+        ok = parse_graph_line(g, t, lineno, out);
+    }
+    free(line);
+    fclose(f);
+    if (!ok)
+        return false;
+
+    // resolve dependency names into edges
+    for (int i = 0; i < g->count; i++)
+    {
+        graph_node_t *n = &g->nodes[i];
+        n->pending = n->dep_count;
+        for (int d = 0; d < n->dep_count; d++)
+        {
+            int dep = find_node(g, n->dep_names[d]);
+            if (dep < 0)
+            {
+                fprintf(out, "rungraph: %s depends on unknown target %s\n", n->name, n->dep_names[d]);
+                return false;
+            }
+            graph_node_t *dn = &g->nodes[dep];
+            int *grown = realloc(dn->dependents, (dn->dependent_count + 1) * sizeof(int));
+            if (!grown)
+                return false;
+            dn->dependents = grown;
+            dn->dependents[dn->dependent_count++] = i;
+        }
+    }
+    return true;
+}
+
+// Kahn's algorithm up front: a cycle means some nodes never become ready
+static bool check_acyclic(graph_t *g, FILE *out)
+{
+    int *pending = malloc(g->count * sizeof(int));
+    int *queue = malloc(g->count * sizeof(int));
+    if (!pending || !queue)
+    {
+        free(pending);
+        free(queue);
+        return false;
+    }
+
+    int head = 0, tail = 0;
+    for (int i = 0; i < g->count; i++)
+    {
+        pending[i] = g->nodes[i].dep_count;
+        if (pending[i] == 0)
+            queue[tail++] = i;
+    }
+    while (head < tail)
+    {
+        graph_node_t *n = &g->nodes[queue[head++]];
+        for (int k = 0; k < n->dependent_count; k++)
+            if (--pending[n->dependents[k]] == 0)
+                queue[tail++] = n->dependents[k];
+    }
+
+    bool acyclic = (tail == g->count);
+    if (!acyclic)
+    {
+        fprintf(out, "rungraph: dependency cycle among:");
+        for (int i = 0; i < g->count; i++)
+            if (pending[i] > 0)
+                fprintf(out, " %s", g->nodes[i].name);
+        fprintf(out, "\n");
+    }
+    free(pending);
+    free(queue);
+    return acyclic;
+}
+
+// a node's command runs in a forked copy of the shell, so pipelines, redirections
+// and builtins all work; a plain external command is exec'd in place there
+static pid_t spawn_subshell(const char *command, void (*run_command)(char *))
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    setpgid(0, 0);
+    int dn = open("/dev/null", O_RDONLY);
+    if (dn >= 0)
+    {
+        dup2(dn, STDIN_FILENO);
+        close(dn);
+    }
+    // the parent's jobs are not ours to report or kill
+    jobs_forget_all();
+    // nor is its history ours to write
+    log_set_enabled(false);
+
+    char *line = strdup(command);
+    if (!line)
+        _exit(1);
+    exec_in_place = can_exec_in_place(line);
+    run_command(line);
+    fflush(stdout);
+    _exit(last_exit_status);
+}
+
+// a failed node takes everything downstream of it along
+static void skip_dependents(graph_t *g, int failed, FILE *out)
+{
+    graph_node_t *n = &g->nodes[failed];
+    for (int k = 0; k < n->dependent_count; k++)
+    {
+        graph_node_t *d = &g->nodes[n->dependents[k]];
+        if (d->state != NODE_WAITING)
+            continue;
+        d->state = NODE_SKIPPED;
+        fprintf(out, "[%s] skipped (%s failed)\n", d->name, n->name);
+        skip_dependents(g, n->dependents[k], out);
+    }
+}
+
+void execute_rungraph(char **args, FILE *out, void (*run_command)(char *))
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_jobs = cpus > 0 ? (int)cpus : 1;
+
+    int i = 1;
+    if (args[i] && strncmp(args[i], "-j", 2) == 0)
+    {
+        const char *value = args[i][2] ? args[i] + 2 : args[i + 1];
+        if (!value || atoi(value) <= 0)
+            value = NULL;
+        else
+            max_jobs = atoi(value);
+        i = value ? i + (args[i][2] ? 1 : 2) : -1;
+    }
+    if (i < 0 || !args[i] || args[i + 1])
+    {
+        fprintf(out, "Usage: rungraph [-j N] <graph file>\n");
+        last_exit_status = 2;
+        return;
+    }
+
+    graph_t g = {0};
+    if (!load_graph(&g, args[i], out) || !check_acyclic(&g, out))
+    {
+        free_graph(&g);
+        last_exit_status = 2;
+        return;
+    }
+
+    double begin = timing_now();
+    int running = 0, finished = 0, failed = 0, skipped = 0;
+    bool stopping = false;
+    take_interrupt();
+
+    while (true)
+    {
+        // start every ready node we have room for; command-less nodes finish at once
+        bool progressed = true;
+        while (progressed && !stopping)
+        {
+            progressed = false;
+            for (int k = 0; k < g.count && running < max_jobs; k++)
+            {
+                graph_node_t *n = &g.nodes[k];
+                if (n->state != NODE_WAITING || n->pending > 0)
+                    continue;
+
+                if (!n->command)
+                {
+                    n->state = NODE_DONE;
+                    finished++;
+                    for (int d = 0; d < n->dependent_count; d++)
+                        g.nodes[n->dependents[d]].pending--;
+                    progressed = true;
+                    continue;
+                }
+
+                n->started = timing_now();
+                n->pid = spawn_subshell(n->command, run_command);
+                if (n->pid < 0)
+                {
+                    perror("fork failed");
+                    n->state = NODE_FAILED;
+                    failed++;
+                    skip_dependents(&g, k, out);
+                    progressed = true;
+                    continue;
+                }
+                n->state = NODE_RUNNING;
+                running++;
+                char label[1024];
+                snprintf(label, sizeof(label), "rungraph %s", n->name);
+                jobs_add(n->pid, label);
+            }
+        }
+
+        if (running == 0)
+            break;
+
+        int status;
+        struct rusage ru;
+        pid_t pid = wait_child_or_interrupt(&status, &ru);
+        if (pid < 0)
+            break;
+
+        // Ctrl-C: start nothing new and stop what is still running
+        if (take_interrupt() && !stopping)
+        {
+            stopping = true;
+            for (int r = 0; r < g.count; r++)
+                if (g.nodes[r].state == NODE_RUNNING)
+                    kill(-g.nodes[r].pid, SIGTERM);
+        }
+        if (pid == 0)
+            continue;
+
+        int k = 0;
+        while (k < g.count && !(g.nodes[k].state == NODE_RUNNING && g.nodes[k].pid == pid))
+            k++;
+        if (k == g.count)
+        {
+            // somebody else's child: let the job table report it
+            handle_child_status(pid, status);
+            continue;
+        }
+
+        graph_node_t *n = &g.nodes[k];
+        job_t *job = jobs_find_by_pid(pid);
+        if (job)
+            jobs_remove_by_index(job - job_list);
+        running--;
+
+        int code = exit_code_from_status(status);
+        double elapsed = timing_now() - n->started;
+        if (code == 0)
+        {
+            n->state = NODE_DONE;
+            finished++;
+            fprintf(out, "[%s] ok  %.3fs\n", n->name, elapsed);
+            for (int d = 0; d < n->dependent_count; d++)
+                g.nodes[n->dependents[d]].pending--;
+        }
+        else
+        {
+            n->state = NODE_FAILED;
+            failed++;
+            fprintf(out, "[%s] failed (exit %d)  %.3fs\n", n->name, code, elapsed);
+            skip_dependents(&g, k, out);
+        }
+        fflush(out);
+    }
+
+    for (int k = 0; k < g.count; k++)
+        if (g.nodes[k].state == NODE_SKIPPED || g.nodes[k].state == NODE_WAITING)
+            skipped++;
+
+    fprintf(out, "rungraph: %d done, %d failed, %d skipped, %.3fs\n",
+            finished, failed, skipped, timing_now() - begin);
+    last_exit_status = (failed || skipped) ? 1 : 0;
+    free_graph(&g);
+}
@@ -0,0 +1,157 @@
+#include "scan.h"
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#ifdef __SSE2__
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+size_t scan_word_scalar(const char *p)
+{
+    size_t len = 0;
+    while (p[len] && !isspace((unsigned char)p[len]) && !strchr("|&<>;", p[len]))
+        len++;
+    return len;
+}
+
+#ifdef SCAN_X86
+// Loads are aligned, so a block never crosses into the next page and reading
+// up to the end of the block past the NUL is safe. The bytes of the first
+// block that come before p are shifted out of the mask.
+
+// a bit for every byte that ends a word: NUL, ' ', '\t'..'\r' (isspace in
+// the C locale) or a metacharacter
+static inline int stop_mask_sse2(__m128i v)
+{
+    // '\t'..'\r' become 0..4 after subtracting 9; saturating 0..4 down by 4 gives 0
+    __m128i ctrl = _mm_subs_epu8(_mm_sub_epi8(v, _mm_set1_epi8('\t')), _mm_set1_epi8(4));
+    __m128i hit = _mm_cmpeq_epi8(ctrl, _mm_setzero_si128());
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8('|')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8('&')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+    return _mm_movemask_epi8(hit);
+}
+
+static size_t scan_word_sse2(const char *p)
+{
+    size_t skew = (uintptr_t)p & 15;
+    const char *block = p - skew;
+    unsigned int mask = (unsigned int)stop_mask_sse2(_mm_load_si128((const __m128i *)block)) >> skew;
+    if (mask)
+        return __builtin_ctz(mask);
+    while (true)
+    {
+        block += 16;
+        mask = stop_mask_sse2(_mm_load_si128((const __m128i *)block));
+        if (mask)
+            return block + __builtin_ctz(mask) - p;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int stop_mask_avx2(__m256i v)
+{
+    __m256i ctrl = _mm256_subs_epu8(_mm256_sub_epi8(v, _mm256_set1_epi8('\t')), _mm256_set1_epi8(4));
+    __m256i hit = _mm256_cmpeq_epi8(ctrl, _mm256_setzero_si256());
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('|')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('&')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+    return (unsigned int)_mm256_movemask_epi8(hit);
+}
+
+// most words end within the first 16 bytes, so that block is checked on its
+// own before going 32 at a time
+__attribute__((target("avx2")))
+static size_t scan_word_avx2(const char *p)
+{
+    size_t skew = (uintptr_t)p & 15;
+    const char *block = p - skew;
+    unsigned int mask = (unsigned int)stop_mask_sse2(_mm_load_si128((const __m128i *)block)) >> skew;
+    if (mask)
+        return __builtin_ctz(mask);
+    block += 16;
+    if ((uintptr_t)block & 31)
+    {
+        mask = stop_mask_sse2(_mm_load_si128((const __m128i *)block));
+        if (mask)
+            return block + __builtin_ctz(mask) - p;
+        block += 16;
+    }
+    while (true)
+    {
+        mask = stop_mask_avx2(_mm256_load_si256((const __m256i *)block));
+        if (mask)
+            return block + __builtin_ctz(mask) - p;
+        block += 32;
+    }
+}
+#endif
+
+static size_t (*scan_word_fn)(const char *) = scan_word_scalar;
+static const char *scan_word_name = "scalar";
+static pthread_once_t scan_once = PTHREAD_ONCE_INIT;
+
+static void pick_scan_word(void)
+{
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scan_word_fn = scan_word_avx2;
+        scan_word_name = "avx2";
+        return;
+    }
+    // the compiler was allowed SSE2, so the CPU has it
+    scan_word_fn = scan_word_sse2;
+    scan_word_name = "sse2";
+#endif
+}
+
+size_t scan_word(const char *p)
+{
+    pthread_once(&scan_once, pick_scan_word);
+    return scan_word_fn(p);
+}
+
+const char *scan_word_impl(void)
+{
+    pthread_once(&scan_once, pick_scan_word);
+    return scan_word_name;
+}
+
+bool scan_word_select(const char *impl)
+{
+    pthread_once(&scan_once, pick_scan_word);
+    if (strcmp(impl, "scalar") == 0)
+    {
+        scan_word_fn = scan_word_scalar;
+        scan_word_name = "scalar";
+        return true;
+    }
+#ifdef SCAN_X86
+    if (strcmp(impl, "sse2") == 0)
+    {
+        scan_word_fn = scan_word_sse2;
+        scan_word_name = "sse2";
+        return true;
+    }
+    if (strcmp(impl, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        scan_word_fn = scan_word_avx2;
+        scan_word_name = "avx2";
+        return true;
+    }
+#endif
+    return false;
+}
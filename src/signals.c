@@ -1,13 +1,20 @@
+// wait4 is a BSD interface
+#define _DEFAULT_SOURCE
 #include "signals.h"
 #include "jobs.h"
+#include "fanout.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <errno.h>
+#include <time.h>
 
 static volatile sig_atomic_t sigchld_flag = 0;
+static volatile sig_atomic_t sigint_flag = 0;
 pid_t fg_pid = -1;
 
 static void handle_sigchld(int sig) {
@@ -17,6 +24,7 @@ static void handle_sigchld(int sig) {
 
 static void handle_sigint(int sig) {
     (void)sig;
+    sigint_flag = 1;
     if (fg_pid > 0) kill(-fg_pid, SIGINT);
 }
 
@@ -25,6 +33,37 @@ static void handle_sigtstp(int sig) {
     if (fg_pid > 0) kill(-fg_pid, SIGTSTP);
 }
 
+// long-running builtins poll this to notice Ctrl-C
+bool take_interrupt(void) {
+    bool pending = sigint_flag != 0;
+    sigint_flag = 0;
+    return pending;
+}
+
+// wait4(-1) for builtins that babysit their own children. SA_RESTART would
+// keep a blocking wait4 asleep through Ctrl-C, so block SIGCHLD/SIGINT, poll,
+// and sigsuspend until one of them shows up. Returns the reaped pid, 0 when
+// Ctrl-C is pending (left for take_interrupt), -1 if there is no child
+pid_t wait_child_or_interrupt(int *status, struct rusage *ru) {
+    sigset_t block, old, wait_mask;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigaddset(&block, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    wait_mask = old;
+    sigdelset(&wait_mask, SIGCHLD);
+    sigdelset(&wait_mask, SIGINT);
+
+    pid_t pid;
+    while ((pid = wait4(-1, status, WNOHANG, ru)) == 0 && !sigint_flag)
+        sigsuspend(&wait_mask);
+
+    int saved_errno = errno;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    errno = saved_errno;
+    return pid;
+}
+
 void install_signal_handlers(void) {
     struct sigaction sa = {0};
     sa.sa_handler = handle_sigchld;
@@ -42,40 +81,66 @@ void install_signal_handlers(void) {
     signal(SIGTTOU, SIG_IGN);
 }
 
+// report one reaped/stopped/continued child against the job table.
+// returns true if anything was printed
+bool handle_child_status(pid_t pid, int status) {
+    job_t *job = jobs_find_by_pid(pid);
+    if (WIFSTOPPED(status)) {
+        jobs_mark_stopped(pid);
+        return true;
+    }
+    if (WIFCONTINUED(status)) {
+        if (job) job->state = RUNNING;
+        return true;
+    }
+    if (job) {
+        // a pipeline is done when its last process is
+        if (!jobs_member_done(job, pid, status))
+            return false;
+        if (WIFSIGNALED(job->last_status)) {
+            printf("[%d] %s with pid %d terminated by signal %d\n",
+                   job->job_id, job->command, job->pid, WTERMSIG(job->last_status));
+        } else {
+            printf("[%d] %s with pid %d exited normally\n",
+                   job->job_id, job->command, job->pid);
+        }
+        fflush(stdout);
+        jobs_remove_by_index(job - job_list);
+        return true;
+    }
+    return false;
+}
+
 bool process_signal_events(void) {
-    if (!sigchld_flag) return false;
-    sigchld_flag = 0;
+    bool printed = jobs_reap_tasks();
+    if (sigchld_flag) {
+        sigchld_flag = 0;
 
-    int saved_errno = errno;
-    bool printed = false;
+        int saved_errno = errno;
 
-    int status;
-    pid_t pid;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        job_t *job = jobs_find_by_pid(pid);
-        if (job) {
-            if (WIFEXITED(status)) {
-                printf("[%d] %s with pid %d exited normally\n",
-                       job->job_id, job->command, job->pid);
-            } else if (WIFSIGNALED(status)) {
-                printf("[%d] %s with pid %d terminated by signal %d\n",
-                       job->job_id, job->command, job->pid, WTERMSIG(status));
-            }
-            fflush(stdout);
-            jobs_remove_by_index(job - job_list);
-            printed = true;
-        }
-        else if (WIFSTOPPED(status)) {
-            jobs_mark_stopped(pid);
-            printed = true;
-        }
-        else if (WIFCONTINUED(status)) {
-            job = jobs_find_by_pid(pid);
-            if (job) job->state = RUNNING;
-            printed = true;
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            if (handle_child_status(pid, status))
+                printed = true;
         }
-    }
 
-    errno = saved_errno;
+        errno = saved_errno;
+    }
+    // finished jobs make room for queued ones
+    jobs_admit_queued();
     return printed;
 }
+
+// batch mode: queued jobs were promised a run and in-process jobs (fan-out
+// relays included) would die with the shell, so see them through before exiting
+void wait_for_batch_jobs(void) {
+    while (jobs_queued() > 0 || jobs_tasks_running() > 0 || fanout_active() > 0) {
+        process_signal_events();
+        if (jobs_queued() == 0 && jobs_tasks_running() == 0 && fanout_active() == 0)
+            break;
+        // SIGCHLD cuts the sleep short; the timeout covers in-process jobs
+        struct timespec ts = {0, 10 * 1000 * 1000};
+        nanosleep(&ts, NULL);
+    }
+}
@@ -0,0 +1,268 @@
+#include "spawner.h"
+#include "pathcache.h"
+#include "launch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+spawn_mode_t spawn_mode = SPAWN_AUTO;
+
+void spawn_request_init(spawn_request_t *req, char **argv)
+{
+    req->argv = argv;
+    req->pgid = 0;
+    req->in_fd = -1;
+    req->out_fd = -1;
+    req->null_stdin = false;
+    req->attrs = NULL;
+}
+
+// the shell ignores these, but children should get the default job control behaviour back
+static void reset_job_control_signals(sigset_t *set)
+{
+    sigemptyset(set);
+    sigaddset(set, SIGTTIN);
+    sigaddset(set, SIGTTOU);
+}
+
+// fast path: posix_spawn shares the parent's memory until exec, so no page tables are copied
+static pid_t spawn_with_posix_spawn(const spawn_request_t *req, const char *path)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t defaults;
+    pid_t pid;
+    int err;
+
+    if ((err = posix_spawn_file_actions_init(&actions)) != 0)
+    {
+        errno = err;
+        return -1;
+    }
+    if ((err = posix_spawnattr_init(&attr)) != 0)
+    {
+        posix_spawn_file_actions_destroy(&actions);
+        errno = err;
+        return -1;
+    }
+
+    // same order as the fork path: /dev/null first, then an explicit "<" wins
+    if (req->null_stdin)
+        err = posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    if (!err && req->in_fd >= 0 && req->in_fd != STDIN_FILENO)
+        err = posix_spawn_file_actions_adddup2(&actions, req->in_fd, STDIN_FILENO);
+    if (!err && req->out_fd >= 0 && req->out_fd != STDOUT_FILENO)
+        err = posix_spawn_file_actions_adddup2(&actions, req->out_fd, STDOUT_FILENO);
+
+    reset_job_control_signals(&defaults);
+    if (!err)
+        err = posix_spawnattr_setsigdefault(&attr, &defaults);
+    if (!err)
+        err = posix_spawnattr_setpgroup(&attr, req->pgid);
+    if (!err)
+        err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+
+    if (!err)
+        err = posix_spawn(&pid, path, &actions, &attr, req->argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err)
+    {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+// the part of a request that a forked child (or the shell itself, when it
+// execs in place) applies by hand
+static void apply_request_in_child(const spawn_request_t *req)
+{
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+
+    if (req->null_stdin)
+    {
+        int dn = open("/dev/null", O_RDONLY);
+        if (dn >= 0)
+        {
+            dup2(dn, STDIN_FILENO);
+            close(dn);
+        }
+    }
+    if (req->in_fd >= 0 && req->in_fd != STDIN_FILENO)
+        dup2(req->in_fd, STDIN_FILENO);
+    if (req->out_fd >= 0 && req->out_fd != STDOUT_FILENO)
+        dup2(req->out_fd, STDOUT_FILENO);
+
+    launch_apply(req->attrs);
+}
+
+// fallback: classic fork+exec. exec errors travel back over a close-on-exec pipe
+// so callers see the same result as with posix_spawn
+static pid_t spawn_with_fork(const spawn_request_t *req, const char *path)
+{
+    int errpipe[2];
+    if (pipe(errpipe) < 0)
+        return -1;
+    fcntl(errpipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(errpipe[1], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        int saved = errno;
+        close(errpipe[0]);
+        close(errpipe[1]);
+        errno = saved;
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        // child
+        close(errpipe[0]);
+        setpgid(0, req->pgid);
+        apply_request_in_child(req);
+
+        execv(path, req->argv);
+        int child_errno = errno;
+        ssize_t ignored = write(errpipe[1], &child_errno, sizeof(child_errno));
+        (void)ignored;
+        _exit(127);
+    }
+
+    // parent
+    close(errpipe[1]);
+    int child_errno;
+    ssize_t n;
+    while ((n = read(errpipe[0], &child_errno, sizeof(child_errno))) < 0 && errno == EINTR)
+        ;
+    close(errpipe[0]);
+
+    if (n == (ssize_t)sizeof(child_errno))
+    {
+        while (waitpid(pid, NULL, 0) < 0 && errno == EINTR)
+            ;
+        errno = child_errno;
+        return -1;
+    }
+    return pid;
+}
+
+static pid_t spawn_program(const spawn_request_t *req, const char *path)
+{
+    if (spawn_mode == SPAWN_FORK || req->attrs)
+        return spawn_with_fork(req, path);
+
+    pid_t pid = spawn_with_posix_spawn(req, path);
+    // kernels/libcs without a usable posix_spawn fall back to fork
+    if (pid < 0 && errno == ENOSYS)
+        return spawn_with_fork(req, path);
+    return pid;
+}
+
+// an executable the kernel won't run (no "#!" line) is a shell script, the
+// way execvp sees it: "/bin/sh path args...". NULL if out of memory
+static char **script_argv(const char *path, char **argv)
+{
+    int argc = 0;
+    while (argv[argc])
+        argc++;
+    char **sh_argv = malloc((argc + 2) * sizeof(char *));
+    if (!sh_argv)
+        return NULL;
+    sh_argv[0] = "/bin/sh";
+    sh_argv[1] = (char *)path;
+    for (int i = 1; i <= argc; i++)
+        sh_argv[i + 1] = argv[i];
+    return sh_argv;
+}
+
+static pid_t spawn_resolved(const spawn_request_t *req, const char *path)
+{
+    pid_t pid = spawn_program(req, path);
+    if (pid >= 0 || errno != ENOEXEC)
+        return pid;
+
+    spawn_request_t script = *req;
+    script.argv = script_argv(path, req->argv);
+    if (!script.argv)
+    {
+        errno = ENOEXEC;
+        return -1;
+    }
+    pid = spawn_program(&script, "/bin/sh");
+    int saved = errno;
+    free(script.argv);
+    errno = saved;
+    return pid;
+}
+
+int spawn_report_failure(const char *name, int err)
+{
+    if (err == ENOENT)
+    {
+        // tests expect this exact string
+        fprintf(stderr, "Command not found!\n");
+        return 127;
+    }
+    fprintf(stderr, "%s: %s\n", name, strerror(err));
+    return 126;
+}
+
+pid_t spawn_process(const spawn_request_t *req)
+{
+    // builtin output still sitting in our buffer must come out before the child's
+    fflush(stdout);
+
+    const char *path = path_lookup(req->argv[0]);
+    if (!path)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    pid_t pid = spawn_resolved(req, path);
+
+    // a remembered path that vanished: forget it and search $PATH once more
+    if (pid < 0 && errno == ENOENT && path != req->argv[0])
+    {
+        path_cache_forget(req->argv[0]);
+        path = path_lookup(req->argv[0]);
+        if (path)
+            pid = spawn_resolved(req, path);
+        else
+            errno = ENOENT;
+    }
+    return pid;
+}
+
+void spawn_exec_in_place(const spawn_request_t *req)
+{
+    const char *path = path_lookup(req->argv[0]);
+    if (!path)
+    {
+        errno = ENOENT;
+        return;
+    }
+    apply_request_in_child(req);
+    execv(path, req->argv);
+    if (errno != ENOEXEC)
+        return;
+    char **sh_argv = script_argv(path, req->argv);
+    if (sh_argv)
+        execv("/bin/sh", sh_argv);
+    free(sh_argv);
+    errno = ENOEXEC;
+}
@@ -0,0 +1,169 @@
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/resource.h>
+
+typedef struct stage_usage {
+    char name[32];
+    double wall;
+    struct rusage ru;
+} stage_usage_t;
+
+bool timing_active = false;
+
+static stage_usage_t *stages = NULL;
+static int stage_count = 0;
+static int stage_capacity = 0;
+static double begin_wall;
+static struct rusage begin_self;
+
+double timing_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double tv_seconds(const struct timeval *tv)
+{
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+void timing_begin(timing_frame_t *outer)
+{
+    outer->active = timing_active;
+    if (timing_active)
+    {
+        outer->stages = stages;
+        outer->stage_count = stage_count;
+        outer->stage_capacity = stage_capacity;
+        outer->begin_wall = begin_wall;
+        outer->begin_self = begin_self;
+        // the outer report keeps its buffer; this one gets its own
+        stages = NULL;
+        stage_capacity = 0;
+    }
+    timing_active = true;
+    stage_count = 0;
+    getrusage(RUSAGE_SELF, &begin_self);
+    begin_wall = timing_now();
+}
+
+void timing_record(const char *name, double wall, const struct rusage *ru)
+{
+    if (!timing_active)
+        return;
+    if (stage_count == stage_capacity)
+    {
+        int cap = stage_capacity ? stage_capacity * 2 : 8;
+        stage_usage_t *grown = realloc(stages, cap * sizeof(stage_usage_t));
+        if (!grown)
+            return;
+        stages = grown;
+        stage_capacity = cap;
+    }
+    stage_usage_t *s = &stages[stage_count++];
+    strncpy(s->name, name ? name : "?", sizeof(s->name) - 1);
+    s->name[sizeof(s->name) - 1] = '\0';
+    s->wall = wall;
+    s->ru = *ru;
+}
+
+static void print_row(const char *label, const char *name, double wall, double user, double sys,
+                      long maxrss, long minflt, long majflt, long nvcsw, long nivcsw)
+{
+    fprintf(stderr, "%-6s %-12s %9.3fs %9.3fs %9.3fs %9ldKB %8ld %6ld %7ld %7ld\n",
+            label, name, wall, user, sys, maxrss, minflt, majflt, nvcsw, nivcsw);
+}
+
+static void report(void)
+{
+    double wall = timing_now() - begin_wall;
+    // keep the report after whatever the command printed
+    fflush(stdout);
+
+    // the shell's own share covers builtins that ran in-process
+    struct rusage self;
+    getrusage(RUSAGE_SELF, &self);
+    double user = tv_seconds(&self.ru_utime) - tv_seconds(&begin_self.ru_utime);
+    double sys = tv_seconds(&self.ru_stime) - tv_seconds(&begin_self.ru_stime);
+    long maxrss = 0;
+    long minflt = self.ru_minflt - begin_self.ru_minflt;
+    long majflt = self.ru_majflt - begin_self.ru_majflt;
+    long nvcsw = self.ru_nvcsw - begin_self.ru_nvcsw;
+    long nivcsw = self.ru_nivcsw - begin_self.ru_nivcsw;
+
+    fprintf(stderr, "%-6s %-12s %10s %10s %10s %11s %8s %6s %7s %7s\n",
+            "stage", "command", "real", "user", "sys", "maxrss", "minflt", "majflt", "nvcsw", "nivcsw");
+
+    for (int i = 0; i < stage_count; i++)
+    {
+        stage_usage_t *s = &stages[i];
+        double u = tv_seconds(&s->ru.ru_utime);
+        double k = tv_seconds(&s->ru.ru_stime);
+
+        // a single command's row would just repeat the total
+        if (stage_count > 1)
+        {
+            char label[16];
+            snprintf(label, sizeof(label), "%d", i + 1);
+            print_row(label, s->name, s->wall, u, k, s->ru.ru_maxrss,
+                      s->ru.ru_minflt, s->ru.ru_majflt, s->ru.ru_nvcsw, s->ru.ru_nivcsw);
+        }
+
+        user += u;
+        sys += k;
+        if (s->ru.ru_maxrss > maxrss)
+            maxrss = s->ru.ru_maxrss;
+        minflt += s->ru.ru_minflt;
+        majflt += s->ru.ru_majflt;
+        nvcsw += s->ru.ru_nvcsw;
+        nivcsw += s->ru.ru_nivcsw;
+    }
+
+    print_row("total", stage_count == 1 ? stages[0].name : "", wall, user, sys, maxrss,
+              minflt, majflt, nvcsw, nivcsw);
+}
+
+void timing_end(timing_frame_t *outer)
+{
+    if (!timing_active)
+        return;
+    report();
+    timing_active = false;
+    if (!outer->active)
+        return;
+
+    stage_usage_t *inner = stages;
+    int inner_count = stage_count;
+    stages = outer->stages;
+    stage_count = outer->stage_count;
+    stage_capacity = outer->stage_capacity;
+    begin_wall = outer->begin_wall;
+    begin_self = outer->begin_self;
+    timing_active = true;
+    for (int i = 0; i < inner_count; i++)
+        timing_record(inner[i].name, inner[i].wall, &inner[i].ru);
+    free(inner);
+}
+
+// "time" keyword: report resource usage of the pipeline or command that follows
+void execute_time(char *line, void (*run)(char *))
+{
+    size_t L = strlen(line);
+    while (L > 0 && isspace((unsigned char)line[L - 1]))
+        L--;
+    // a background job finishes long after we could report on it
+    bool timed = !(L > 0 && line[L - 1] == '&');
+
+    timing_frame_t outer;
+    if (timed)
+        timing_begin(&outer);
+    if (L > 0)
+        run(line);
+    if (timed)
+        timing_end(&outer);
+}
@@ -0,0 +1,34 @@
+#!/bin/sh
+# here-strings: a quoted operand is one word, spaces and metacharacters included,
+# and a "<<" inside it starts no here-document
+shell="${1:-./shell.out}"
+script=$(mktemp)
+trap 'rm -f "$script"' EXIT
+
+cat > "$script" <<'SCRIPT'
+cat <<< "hello world"
+cat <<< 'a  b|c;d'
+cat <<< "x y" | wc -w
+cat <<<word
+cat <<< "x <<y"
+echo not a body
+cat <<< "never closed
+echo after
+SCRIPT
+
+expected='hello world
+a  b|c;d
+2
+word
+x <<y
+not a body
+Invalid Syntax!
+after'
+
+actual=$("$shell" "$script" 2>&1)
+if [ "$actual" != "$expected" ]; then
+    echo "here_string: FAIL"
+    printf 'expected:\n%s\ngot:\n%s\n' "$expected" "$actual"
+    exit 1
+fi
+echo "here_string: ok"